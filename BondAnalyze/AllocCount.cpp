@@ -0,0 +1,37 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include "AllocCount.h"
+
+static std::atomic<long long> nAlloc(0);
+
+void * operator new(std::size_t size)
+{
+	nAlloc.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	nAlloc.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete[](void * p) noexcept { std::free(p); }
+void operator delete(void * p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void * p, std::size_t) noexcept { std::free(p); }
+
+long long AllocCount() { return nAlloc.load(std::memory_order_relaxed); }
@@ -0,0 +1,10 @@
+#ifndef ALLOCCOUNT_H_
+#define ALLOCCOUNT_H_
+
+// test hook counting heap allocations, in every build: the global operator new is replaced by a counting one
+// e.g. BondAnalyze --alloc-check / --self-check check that a steady frame allocates nothing
+
+// number of operator new calls so far
+long long AllocCount();
+
+#endif // !ALLOCCOUNT_H_
@@ -0,0 +1,331 @@
+#include <sstream>
+#include <stdexcept>
+#include "Analyzer.h"
+#include "XyzReader.h"
+#include "FrameFilter.h"
+#include "FinderAtom.h"
+#include "FinderBond.h"
+#include "FinderTrack.h"
+#include "FinderAngle.h"
+#include "FinderDihedral.h"
+#include "FinderCoord.h"
+#include "FinderContact.h"
+
+using std::string;
+using std::vector;
+using std::istream;
+using std::istringstream;
+using std::ostringstream;
+
+// read an atom selector: E iE jE min/max num
+static bool ReadSelector(istream & sin, AtomSelector & selector)
+{
+	string E, iE, jE, sort_type;
+	int num;
+
+	if (!(sin >> E >> iE >> jE >> sort_type >> num))
+		return false;
+
+	selector = AtomSelector(E, iE, jE, sort_type, num);
+	return true;
+}
+
+// read one rule, return nullptr if invalid
+//   bond     iE jE min/max num
+//   track    iE jE min/max num [ref]                                bond followed by its atoms from frame ref, default 0
+//   atom     <selector a> <selector b>                              distance a-b
+//   angle    <selector a> <selector b> <selector c>                 angle a-b-c
+//   dihedral <selector a> <selector b> <selector c> <selector d>    dihedral a-b-c-d
+//   coord    <selector a> nE rcut                                   number of nE atoms within rcut of a
+//   contactmap iE jE rcut [delta_file]                             number of iE-jE pairs within rcut
+// all rules of a frame share the sorted bonds of Molecule, each BondType is sorted once per frame
+// a rule the molecule can't have (unknown element, BondType or rank) throws std::invalid_argument
+static FinderBase * ReadRule(istream & sin)
+{
+	string var;
+	sin >> var;
+	if (var == "bond") {
+		string iE, jE, sort_type;
+		int num;
+
+		if (sin >> iE >> jE >> sort_type >> num)
+			return new FinderBond(iE, jE, sort_type, num);
+	}
+	else if (var == "track") {
+		string iE, jE, sort_type;
+		int num;
+		long long ref = 0;
+
+		if (sin >> iE >> jE >> sort_type >> num) {
+			sin >> ref;
+			return new FinderTrack(iE, jE, sort_type, num, ref);
+		}
+	}
+	else if (var == "atom" || var == "angle" || var == "dihedral") {
+		const int nSelector = (var == "atom") ? 2 : ((var == "angle") ? 3 : 4);
+		AtomSelector selector[4];
+
+		for (int i = 0; i < nSelector; ++i) {
+			if (!ReadSelector(sin, selector[i]))
+				return nullptr;
+		}
+
+		if (var == "atom")
+			return new FinderAtom(selector[0], selector[1]);
+		else if (var == "angle")
+			return new FinderAngle(selector[0], selector[1], selector[2]);
+		else
+			return new FinderDihedral(selector[0], selector[1], selector[2], selector[3]);
+	}
+	else if (var == "coord") {
+		AtomSelector selector;
+		string nE;
+		double rcut;
+
+		if (ReadSelector(sin, selector) && sin >> nE >> rcut)
+			return new FinderCoord(selector, nE, rcut);
+	}
+	else if (var == "contactmap") {
+		string iE, jE, delta_file;
+		double rcut;
+
+		if (sin >> iE >> jE >> rcut) {
+			sin >> delta_file;
+			return new FinderContact(iE, jE, rcut, delta_file);
+		}
+	}
+
+	return nullptr;
+}
+
+Analyzer::Analyzer()
+	:rule(), rule_text(), rule_error(), syntax_error(false), molc(), ifOwn(false), nCol(0), batch()
+{
+}
+
+void Analyzer::LoadSchema(istream & cfg)
+{
+	Molecule::usingBond();
+	Molecule::InputInfo(cfg);
+}
+
+bool Analyzer::AddRule(const string & line)
+{
+	istringstream sin(line);
+	FinderBase * finder = nullptr;
+	try {
+		finder = ReadRule(sin);
+		rule_error = finder ? "" : "syntax error";
+		syntax_error = !finder;
+	}
+	catch (std::invalid_argument & e) {
+		rule_error = e.what();
+		syntax_error = false;
+	}
+	if (!finder)
+		return false;
+
+	rule.emplace_back(finder);
+
+	istringstream words(line);
+	string word;
+	for (int i = 0; words >> word; ++i)
+		rule_text += (i > 0 ? " " : "") + word;
+	rule_text += '\n';
+	return true;
+}
+
+bool Analyzer::ifWriteFile() const
+{
+	for (const auto & r : rule) {
+		if (r->ifWriteFile())
+			return true;
+	}
+	return false;
+}
+
+bool Analyzer::AddRules(istream & fin, string * bad_line)
+{
+	string line;
+	while (getline(fin, line)) {
+		if (line.empty() || line[0] == '#' || line[0] == ' ' || line[0] == '\r')
+			continue;
+
+		if (!AddRule(line)) {
+			if (bad_line)
+				*bad_line = line;
+			return false;
+		}
+	}
+	return true;
+}
+
+void Analyzer::Compile()
+{
+	std::shared_ptr<Molecule> own(new Molecule());
+
+	if (ifRule()) {
+		vector<bool> needContact(Molecule::ContactNum(), false);
+		RequireContact(needContact);
+		own->UseContact(needContact);
+	}
+
+	Compile(own);
+	ifOwn = true;
+	Project();
+}
+
+void Analyzer::Project()
+{
+	// parse and calculate only what the rules need
+	if (!ifRule())
+		return;
+
+	vector<bool> needBondtype(Molecule::nBondtype, false);
+	Require(needBondtype);
+	vector<bool> needAtom(Molecule::totAtom, false);
+	RequireAtom(needAtom);
+	molc->Project(needBondtype, needAtom);
+}
+
+void Analyzer::Require(vector<bool> & needBondtype) const
+{
+	if (ifRule()) {
+		for (const auto & r : rule)
+			r->Require(needBondtype);
+	}
+	else {
+		needBondtype.assign(Molecule::nBondtype, true);
+	}
+}
+
+void Analyzer::RequireContact(vector<bool> & needContact) const
+{
+	for (const auto & r : rule)
+		r->RequireContact(needContact);
+}
+
+void Analyzer::RequireAtom(vector<bool> & needAtom) const
+{
+	for (const auto & r : rule)
+		r->RequireAtom(needAtom);
+}
+
+bool Analyzer::ifReproject() const
+{
+	for (const auto & r : rule) {
+		if (r->ifReproject())
+			return true;
+	}
+	return false;
+}
+
+void Analyzer::Compile(const std::shared_ptr<Molecule> & shared)
+{
+	molc = shared;
+	ifOwn = false;
+
+	if (ifRule()) {
+		nCol = static_cast<int>(rule.size());
+	}
+	else {
+		nCol = 0;
+		for (int iBondtype = 0; iBondtype < Molecule::nBondtype; ++iBondtype) {
+			nCol += Molecule::nBond[iBondtype];
+			Molecule::usingRank(iBondtype, Molecule::nBond[iBondtype] - 1, false);
+		}
+	}
+}
+
+string Analyzer::ColName(const int & i) const
+{
+	ostringstream sout;
+	if (ifRule()) {
+		sout << "rule" << i + 1;
+	}
+	else {
+		int iBond = i;
+		int iBondtype = 0;
+		while (iBond >= Molecule::nBond[iBondtype])
+			iBond -= Molecule::nBond[iBondtype++];
+		sout << Molecule::bondtype_list[iBondtype] << '(' << iBond + 1 << ')';
+	}
+	return sout.str();
+}
+
+bool Analyzer::ReadFrame(XyzReader & reader)
+{
+	return molc->InputEnergy(reader) && molc->InputX(reader);
+}
+
+bool Analyzer::ReadFrame(XyzReader & reader, const FrameFilter & filter, bool & ifPass)
+{
+	const char * b;
+	const char * e;
+	if (!reader.ReadLine(b, e))
+		return false;
+
+	ifPass = filter.Test(b, e);
+	if (!ifPass)
+		return reader.SkipLines(Molecule::totAtom);
+	return molc->InputEnergy(b) && molc->InputX(reader);
+}
+
+void Analyzer::LoadFrame(const double * x, const double & energy)
+{
+	molc->refEnergy() = energy;
+	molc->InputX(x);
+}
+
+void Analyzer::Analyze(double * row)
+{
+	if (ifRule()) {
+		for (size_t i = 0; i < rule.size(); ++i)
+			row[i] = rule[i]->GetBond(*molc);
+		if (ifOwn && ifReproject())
+			Project();
+	}
+	else {
+		molc->SortAllBond();
+		for (int iBondtype = 0; iBondtype < Molecule::nBondtype; ++iBondtype) {
+			molc->RankedLens(iBondtype, row);
+			row += Molecule::nBond[iBondtype];
+		}
+	}
+}
+
+void Analyzer::Feed(const double * X, const double * energy, const int & nFrame, double * result)
+{
+	const size_t frameSize = 3 * static_cast<size_t>(Molecule::totAtom);
+	for (int iFrame = 0; iFrame < nFrame; ++iFrame) {
+		LoadFrame(X + iFrame * frameSize, energy ? energy[iFrame] : 0.0);
+		Analyze(result + static_cast<size_t>(iFrame) * nCol);
+	}
+}
+
+void Analyzer::Feed(const double * X, const double * energy, const int & nFrame, BatchCallback callback, void * user)
+{
+	batch.resize(static_cast<size_t>(nFrame) * nCol);
+	Feed(X, energy, nFrame, batch.data());
+	callback(batch.data(), nFrame, nCol, user);
+}
+
+string Analyzer::SaveState()
+{
+	ostringstream sout;
+	for (auto & r : rule)
+		r->SaveState(sout);
+	return sout.str();
+}
+
+bool Analyzer::LoadState(const string & state)
+{
+	istringstream sin(state);
+	for (auto & r : rule)
+		r->LoadState(sin);
+	if (!sin)
+		return false;
+	if (ifOwn)
+		Project();
+	return true;
+}
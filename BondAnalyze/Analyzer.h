@@ -0,0 +1,114 @@
+#ifndef ANALYZER_H_
+#define ANALYZER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include "Molecule.h"
+#include "FinderBase.h"
+
+class XyzReader;
+class FrameFilter;
+
+// in-process interface of BondAnalyze
+//
+//   Analyzer::LoadSchema(cfg);              // molecule description, once per process
+//   Analyzer a;
+//   a.AddRule("bond O H min 1");            // no rule: full sorted dump of all bonds
+//   a.Compile();
+//   a.Feed(X, energy, nFrame, result);      // result: nFrame * ColNum() values, row by row
+//
+// a row holds one value per rule, or the sorted lengths of each BondType if there is no rule
+class Analyzer
+{
+public:
+	// callback of Feed, result holds nFrame rows of nCol values
+	typedef void (*BatchCallback)(const double * result, int nFrame, int nCol, void * user);
+
+	Analyzer();
+
+	// =============== schema ===============
+
+	// input molecule description (see Molecule::InputInfo), shared by all Analyzers
+	static void LoadSchema(std::istream & cfg);
+
+	// =============== rules ===============
+
+	// compile one rule, return false if invalid, see RuleError()
+	bool AddRule(const std::string & line);
+	// compile rules of a rule file, skipping comments and blank lines,
+	// return false at the first invalid rule and store it in bad_line
+	bool AddRules(std::istream & fin, std::string * bad_line = nullptr);
+	// finish rules, must be called once before analyzing
+	void Compile();
+	// mark the BondTypes the rules need, all of them for the full dump
+	void Require(std::vector<bool> & needBondtype) const;
+	// mark the contact maps the rules need, see Molecule::UseContact()
+	void RequireContact(std::vector<bool> & needContact) const;
+	// mark the atoms the rules read besides those of their BondTypes, see FinderBase::RequireAtom()
+	void RequireAtom(std::vector<bool> & needAtom) const;
+	// whether the last Analyze changed what the rules need, the owner of a shared Molecule then projects it again;
+	// an Analyzer projects its own Molecule itself
+	bool ifReproject() const;
+	// finish rules on a Molecule shared with other Analyzers, which the caller projects to their needs;
+	// frames are then read into the shared Molecule, not through this Analyzer
+	void Compile(const std::shared_ptr<Molecule> & shared);
+
+	inline bool ifRule() const { return !rule.empty(); }
+	// the rules added, one per line, words separated by one space
+	inline const std::string & RuleText() const { return rule_text; }
+	// why the last rule added was invalid
+	inline const std::string & RuleError() const { return rule_error; }
+	// whether the last invalid rule is malformed, rather than naming elements, BondTypes or ranks the molecule lacks
+	inline bool ifSyntaxError() const { return syntax_error; }
+	// whether a rule writes a file besides the result, see FinderBase::ifWriteFile()
+	bool ifWriteFile() const;
+	// number of values in a row
+	inline int ColNum() const { return nCol; }
+	// name of column i, "rule1" or "O-H(1)"
+	std::string ColName(const int & i) const;
+
+	// =============== analyze ===============
+
+	// read next frame after its atom number line, return false if input ends
+	bool ReadFrame(XyzReader & reader);
+	// same, but only if the comment line passes filter, else skip the atom lines unparsed
+	bool ReadFrame(XyzReader & reader, const FrameFilter & filter, bool & ifPass);
+	// load a frame from 3 * totAtom coordinates
+	void LoadFrame(const double * x, const double & energy);
+	// analyze current frame into row of ColNum() values
+	void Analyze(double * row);
+	// energy of current frame
+	inline double Energy() { return molc->refEnergy(); }
+
+	// analyze nFrame frames of 3 * totAtom coordinates each, energy may be nullptr
+	void Feed(const double * X, const double * energy, const int & nFrame, double * result);
+	void Feed(const double * X, const double * energy, const int & nFrame, BatchCallback callback, void * user);
+
+	// =============== state ===============
+
+	// save / load the state rules carry across frames
+	std::string SaveState();
+	bool LoadState(const std::string & state);
+
+	inline Molecule & refMolecule() { return *molc; }
+	inline std::vector<std::shared_ptr<FinderBase>> & refRule() { return rule; }
+
+private:
+	std::vector<std::shared_ptr<FinderBase>> rule;
+	std::string rule_text;
+	std::string rule_error;
+	bool syntax_error;
+	std::shared_ptr<Molecule> molc;
+	// whether molc is created by Compile(), and so projected by this Analyzer
+	bool ifOwn;
+	int nCol;
+	// result of Feed with callback
+	std::vector<double> batch;
+
+	// project own Molecule to what the rules need now
+	void Project();
+};
+
+#endif // !ANALYZER_H_
@@ -0,0 +1,64 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// bump allocator for per-frame scratch memory, Reset() at the start of each frame
+// blocks added while warming up are merged into one on Reset(), so a steady frame does no heap allocation
+class Arena
+{
+	std::vector<std::unique_ptr<char[]>> block;
+	std::vector<size_t> blockSize;
+	// bytes used in the last block
+	size_t used;
+	// bytes used in all blocks
+	size_t total;
+
+public:
+	explicit Arena(const size_t & size = 1 << 16) :block(), blockSize(), used(0), total(0) {
+		block.reserve(8);
+		blockSize.reserve(8);
+		block.emplace_back(new char[size]);
+		blockSize.push_back(size);
+	}
+
+	// allocate n uninitialized T, valid until next Reset()
+	template<typename T>
+	T * Alloc(const size_t & n) {
+		const size_t align = alignof(T) < alignof(std::max_align_t) ? alignof(T) : alignof(std::max_align_t);
+		size_t pos = (used + align - 1) / align * align;
+		const size_t bytes = n * sizeof(T);
+
+		if (pos + bytes > blockSize.back()) {
+			const size_t size = (bytes > 2 * blockSize.back()) ? bytes : 2 * blockSize.back();
+			block.emplace_back(new char[size]);
+			blockSize.push_back(size);
+			pos = 0;
+		}
+
+		used = pos + bytes;
+		total += bytes;
+		return reinterpret_cast<T *>(block.back().get() + pos);
+	}
+
+	void Reset() {
+		if (block.size() > 1) {
+			size_t size = 0;
+			for (const auto & s : blockSize)
+				size += s;
+			if (size < 2 * total)
+				size = 2 * total;
+
+			block.clear();
+			blockSize.clear();
+			block.emplace_back(new char[size]);
+			blockSize.push_back(size);
+		}
+		used = 0;
+		total = 0;
+	}
+};
+
+#endif // !ARENA_H_
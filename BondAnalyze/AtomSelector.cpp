@@ -0,0 +1,25 @@
+#include <stdexcept>
+#include "AtomSelector.h"
+#include "Molecule.h"
+
+AtomSelector::AtomSelector(const string & E, const string & iE, const string & jE, const string & sort_type, const int & num)
+	:bondnum(num - 1)
+{
+	if (iE == jE)
+		throw std::invalid_argument("iE == jE");
+	else if (E != iE && E != jE)
+		throw std::invalid_argument("E != iE && E != jE");
+
+	elem = Molecule::Elem2Num(E);
+	bondType = Molecule::BondType2Num(Molecule::Elem2Num(iE), Molecule::Elem2Num(jE));
+	sortGreat = (sort_type == "max") ? true : false;
+
+	if (bondnum < 0 || bondnum >= Molecule::nBond[bondType])
+		throw std::invalid_argument("bond num: " + std::to_string(num) + " out of range!");
+	Molecule::usingRank(bondType, bondnum, sortGreat);
+}
+
+int AtomSelector::GetAtom(Molecule & molc) const
+{
+	return molc.RankedBond(bondType, bondnum, sortGreat).getAtom(elem);
+}
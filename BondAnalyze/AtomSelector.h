@@ -0,0 +1,29 @@
+#ifndef ATOMSELECTOR_H_
+#define ATOMSELECTOR_H_
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+class Molecule;
+
+// pick an atom by rank: the atom of element E in the num-th shortest (min) or longest (max) bond of BondType iE-jE
+class AtomSelector
+{
+	int elem;
+	int bondType;
+	int bondnum;
+	bool sortGreat;
+
+public:
+	AtomSelector() :elem(0), bondType(0), bondnum(0), sortGreat(false) {}
+	AtomSelector(
+		const string & E, const string & iE, const string & jE, const string & sort_type, const int & num
+	);
+	int GetAtom(Molecule & molc) const;
+	inline int Elem() const { return elem; }
+	inline void Require(std::vector<bool> & needBondtype) const { needBondtype[bondType] = true; }
+};
+
+#endif // !ATOMSELECTOR_H_
@@ -0,0 +1,144 @@
+#include <sstream>
+#include <fstream>
+#include "BondAnalyzeC.h"
+#include "Analyzer.h"
+#include "Packed.h"
+
+// no C++ exception may leave a function of the C interface: each catches all and returns failure
+
+struct ba_analyzer
+{
+	Analyzer analyzer;
+	bool ifCompiled;
+
+	ba_analyzer() :analyzer(), ifCompiled(false) {}
+};
+
+int ba_load_schema(const char * cfg_text)
+{
+	if (!cfg_text)
+		return 1;
+
+	try {
+		std::istringstream sin(cfg_text);
+		Analyzer::LoadSchema(sin);
+		return (Molecule::totAtom > 0) ? 0 : 1;
+	}
+	catch (...) {
+		return 1;
+	}
+}
+
+int ba_atom_num(void)
+{
+	return Molecule::totAtom;
+}
+
+ba_analyzer * ba_create(void)
+{
+	try {
+		return new ba_analyzer();
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void ba_destroy(ba_analyzer * a)
+{
+	delete a;
+}
+
+int ba_add_rule(ba_analyzer * a, const char * rule)
+{
+	if (!a || !rule || a->ifCompiled)
+		return 1;
+
+	try {
+		return a->analyzer.AddRule(rule) ? 0 : 1;
+	}
+	catch (...) {
+		return 1;
+	}
+}
+
+int ba_add_rules(ba_analyzer * a, const char * rule_text)
+{
+	if (!a || !rule_text || a->ifCompiled)
+		return 1;
+
+	try {
+		std::istringstream sin(rule_text);
+		return a->analyzer.AddRules(sin) ? 0 : 1;
+	}
+	catch (...) {
+		return 1;
+	}
+}
+
+int ba_compile(ba_analyzer * a)
+{
+	if (!a || a->ifCompiled)
+		return 1;
+
+	try {
+		a->analyzer.Compile();
+	}
+	catch (...) {
+		return 1;
+	}
+	a->ifCompiled = true;
+	return 0;
+}
+
+int ba_column_num(const ba_analyzer * a)
+{
+	return (a && a->ifCompiled) ? a->analyzer.ColNum() : 0;
+}
+
+int ba_feed(ba_analyzer * a, const double * X, const double * energy, int nFrame, double * result)
+{
+	if (!a || !a->ifCompiled || !X || !result || nFrame < 0)
+		return 1;
+
+	try {
+		a->analyzer.Feed(X, energy, nFrame, result);
+	}
+	catch (...) {
+		return 1;
+	}
+	return 0;
+}
+
+int ba_feed_callback(ba_analyzer * a, const double * X, const double * energy, int nFrame,
+	ba_batch_callback callback, void * user)
+{
+	if (!a || !a->ifCompiled || !X || !callback || nFrame < 0)
+		return 1;
+
+	try {
+		a->analyzer.Feed(X, energy, nFrame, callback, user);
+	}
+	catch (...) {
+		return 1;
+	}
+	return 0;
+}
+
+int ba_decode_packed(const char * packed_file, const char * text_file)
+{
+	if (!packed_file || !text_file)
+		return 1;
+
+	try {
+		std::ifstream fin(packed_file, std::ifstream::in | std::ifstream::binary);
+		std::ofstream fout(text_file, std::ofstream::out);
+		if (!fin || !fout)
+			return 1;
+
+		return (DecodePacked(fin, fout) && fout.flush()) ? 0 : 1;
+	}
+	catch (...) {
+		return 1;
+	}
+}
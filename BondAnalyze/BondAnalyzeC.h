@@ -0,0 +1,54 @@
+#ifndef BONDANALYZEC_H_
+#define BONDANALYZEC_H_
+
+/* C interface of BondAnalyze, see Analyzer.h
+ *
+ *   ba_load_schema(cfg_text);
+ *   ba_analyzer * a = ba_create();
+ *   ba_add_rule(a, "bond O H min 1");
+ *   ba_compile(a);
+ *   ba_feed(a, X, energy, nFrame, result);    result: nFrame * ba_column_num(a) doubles
+ *   ba_destroy(a);
+ *
+ * X holds nFrame * atom_num * 3 doubles, x y z of each atom in the order of atom_list.
+ * Functions returning int return 0 on success.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ba_analyzer ba_analyzer;
+
+typedef void (*ba_batch_callback)(const double * result, int nFrame, int nCol, void * user);
+
+/* molecule description in the format of $MOLECULE_DIR/.$MOLECULE, once per process */
+int ba_load_schema(const char * cfg_text);
+/* number of atoms of the schema */
+int ba_atom_num(void);
+
+ba_analyzer * ba_create(void);
+void ba_destroy(ba_analyzer * a);
+
+/* compile one rule line, or all rules of a rule file text; 1 if a rule is invalid or names an element,
+ * BondType or rank the schema doesn't have */
+int ba_add_rule(ba_analyzer * a, const char * rule);
+int ba_add_rules(ba_analyzer * a, const char * rule_text);
+/* finish rules, no rule means the full sorted dump */
+int ba_compile(ba_analyzer * a);
+
+int ba_column_num(const ba_analyzer * a);
+
+/* analyze nFrame frames, energy may be NULL */
+int ba_feed(ba_analyzer * a, const double * X, const double * energy, int nFrame, double * result);
+int ba_feed_callback(ba_analyzer * a, const double * X, const double * energy, int nFrame,
+	ba_batch_callback callback, void * user);
+
+/* decode a packed output file (see Packed.h) to a text table */
+int ba_decode_packed(const char * packed_file, const char * text_file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !BONDANALYZEC_H_ */
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include "Checkpoint.h"
+
+using std::ifstream;
+
+bool Checkpoint::Save(const string & file) const
+{
+	const string tmp_file = file + ".tmp";
+
+	FILE * fp = fopen(tmp_file.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	fprintf(fp, "BondAnalyze-checkpoint 1\n");
+	fprintf(fp, "input_offset %lld\n", inOffset);
+	fprintf(fp, "frame %lld\n", frame);
+	fprintf(fp, "output_offset %lld\n", outOffset);
+	fprintf(fp, "state_size %zu\n", state.size());
+	fwrite(state.data(), 1, state.size(), fp);
+
+	bool ok = (fflush(fp) == 0) && (fsync(fileno(fp)) == 0);
+	ok = (fclose(fp) == 0) && ok;
+
+	return ok && (rename(tmp_file.c_str(), file.c_str()) == 0);
+}
+
+bool Checkpoint::Load(const string & file)
+{
+	ifstream fin(file.c_str(), ifstream::in | ifstream::binary);
+
+	string key;
+	int version;
+	size_t state_size;
+
+	fin >> key >> version;
+	if (!fin || key != "BondAnalyze-checkpoint" || version != 1)
+		return false;
+
+	fin >> key >> inOffset;
+	fin >> key >> frame;
+	fin >> key >> outOffset;
+	fin >> key >> state_size;
+	fin.get();
+	if (!fin)
+		return false;
+
+	state.resize(state_size);
+	fin.read(&state[0], state_size);
+
+	return fin.gcount() == static_cast<std::streamsize>(state_size);
+}
+
+bool Checkpoint::Sync(const string & out_file)
+{
+	// fsync of any descriptor of the file writes all of its data
+	const int fd = open(out_file.c_str(), O_WRONLY);
+	if (fd < 0)
+		return false;
+
+	const bool ok = (fsync(fd) == 0);
+	return (close(fd) == 0) && ok;
+}
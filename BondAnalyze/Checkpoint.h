@@ -0,0 +1,33 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+
+using std::string;
+
+// progress of a streaming analysis, saved next to the output file as <out_file>.ckpt
+//
+// text header followed by the raw accumulator state of the rules:
+//   BondAnalyze-checkpoint 1
+//   input_offset <byte offset of the next frame in input file>
+//   frame <number of frames done>
+//   output_offset <byte offset of the end of the last complete row in output file, synced before the save>
+//   state_size <bytes>
+//   <state>
+struct Checkpoint
+{
+	long long inOffset;
+	long long frame;
+	long long outOffset;
+	string state;
+
+	Checkpoint() :inOffset(0), frame(0), outOffset(0), state() {}
+
+	// write to file.tmp, then rename to file, so that file is always a complete checkpoint
+	bool Save(const string & file) const;
+	bool Load(const string & file);
+	// write the data of out_file to disk, before a checkpoint points into it
+	static bool Sync(const string & out_file);
+};
+
+#endif // !CHECKPOINT_H_
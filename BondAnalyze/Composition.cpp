@@ -0,0 +1,184 @@
+#include <sstream>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "Composition.h"
+#include "XyzReader.h"
+#include "FrameFilter.h"
+#include "FinderBase.h"
+
+using std::vector;
+using std::istringstream;
+using std::ostringstream;
+
+// column of a rule not in the composition of the frame
+class FinderMissing : public FinderBase
+{
+public:
+	virtual double GetBond(Molecule &) { return std::numeric_limits<double>::quiet_NaN(); }
+	virtual void Require(std::vector<bool> &) const {}
+};
+
+CompositionCache::CompositionCache(const string & rules, const bool & ifLine, const size_t & maxSlot)
+	:name(Molecule::name), elem_list(Molecule::elem_list), rules(rules), ifLine(ifLine), maxSlot(std::max<size_t>(maxSlot, 1)),
+	slot(), active(nullptr), clock(0), nBuild(0), signature(), x(), energy(0.0)
+{
+	Molecule::Schema empty;
+	Molecule::SwapSchema(empty);
+}
+
+CompositionCache::~CompositionCache()
+{
+	Release();
+}
+
+bool CompositionCache::ReadFrame(XyzReader & reader, const int & count, const FrameFilter & filter, bool & ifPass,
+	string & warning, string & error)
+{
+	const char * b;
+	const char * e;
+	if (!reader.ReadLine(b, e))
+		return false;
+
+	ifPass = filter.Test(b, e);
+	if (!ifPass)
+		return reader.SkipLines(count);
+
+	char * stop;
+	energy = strtod(b, &stop);
+	if (stop == b)
+		return false;
+
+	signature.clear();
+	x.resize(3 * static_cast<size_t>(count));
+	for (int i = 0; i < count; ++i) {
+		if (!reader.ReadLine(b, e))
+			return false;
+
+		while (b < e && (*b == ' ' || *b == '\t'))
+			++b;
+		const char * elem = b;
+		while (b < e && *b != ' ' && *b != '\t')
+			++b;
+		signature.append(elem, b);
+		signature.push_back(' ');
+
+		for (int j = 0; j < 3; ++j) {
+			x[3 * i + j] = strtod(b, &stop);
+			b = stop;
+		}
+	}
+
+	if (!Use(warning, error))
+		return false;
+	active->analyzer->LoadFrame(x.data(), energy);
+	return true;
+}
+
+bool CompositionCache::Use(string & warning, string & error)
+{
+	auto it = slot.find(signature);
+	if (it == slot.end()) {
+		Release();
+		Slot & s = slot[signature];
+		if (!Build(s, warning, error)) {
+			Molecule::Schema empty;
+			Molecule::SwapSchema(empty);
+			slot.erase(signature);
+			return false;
+		}
+		active = &s;
+		nBuild++;
+	}
+	else if (&it->second != active) {
+		Release();
+		Molecule::SwapSchema(it->second.schema);
+		active = &it->second;
+	}
+
+	active->used = ++clock;
+	Evict();
+	return true;
+}
+
+bool CompositionCache::Build(Slot & s, string & warning, string & error)
+{
+	// elements of the molecule description, then those only in this frame
+	vector<string> elem = elem_list;
+	istringstream atoms(signature);
+	string symbol;
+	int nAtom = 0;
+	while (atoms >> symbol) {
+		if (std::find(elem.begin(), elem.end(), symbol) == elem.end())
+			elem.push_back(symbol);
+		nAtom++;
+	}
+
+	ostringstream cfg;
+	cfg << "molecule = " << name << "\n";
+	cfg << "elem_num = " << elem.size() << "\n";
+	cfg << "elem_list = (";
+	for (size_t i = 0; i < elem.size(); ++i)
+		cfg << (i ? " " : "") << elem[i];
+	cfg << ")\n";
+	cfg << "atom_num = " << nAtom << "\n";
+	cfg << "atom_list = (" << signature << ")\n";
+
+	istringstream sin(cfg.str());
+	Analyzer::LoadSchema(sin);
+
+	// a rule naming an element, a BondType or a rank this composition lacks gives NaN, a malformed one is an error
+	s.analyzer.reset(new Analyzer());
+	vector<string> line;
+	if (ifLine) {
+		line.push_back(rules);
+	}
+	else {
+		istringstream rin(rules);
+		string l;
+		while (getline(rin, l)) {
+			if (!(l.empty() || l[0] == '#' || l[0] == ' ' || l[0] == '\r'))
+				line.push_back(l);
+		}
+	}
+	for (const auto & l : line) {
+		if (s.analyzer->AddRule(l))
+			continue;
+		if (s.analyzer->ifSyntaxError()) {
+			error = "invalid rule: " + l;
+			return false;
+		}
+		warning += (warning.empty() ? "" : "; ") + l + " (" + s.analyzer->RuleError() + ")";
+		s.analyzer->refRule().emplace_back(new FinderMissing());
+	}
+	if (!warning.empty())
+		warning = "rules not in the composition of " + std::to_string(nAtom) + " atoms give NaN: " + warning;
+	if (s.analyzer->ifWriteFile() && nBuild > 0) {
+		error = "rules writing a file of their own need frames of one composition";
+		return false;
+	}
+	s.analyzer->Compile();
+	return true;
+}
+
+void CompositionCache::Release()
+{
+	// put the schema in use back to its slot, Molecule is empty then
+	if (active)
+		Molecule::SwapSchema(active->schema);
+	active = nullptr;
+}
+
+void CompositionCache::Evict()
+{
+	while (slot.size() > maxSlot) {
+		auto lru = slot.end();
+		for (auto it = slot.begin(); it != slot.end(); ++it) {
+			if (&it->second != active && (lru == slot.end() || it->second.used < lru->second.used))
+				lru = it;
+		}
+		if (lru == slot.end())
+			break;
+		slot.erase(lru);
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef COMPOSITION_H_
+#define COMPOSITION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Molecule.h"
+#include "Analyzer.h"
+
+using std::string;
+
+class XyzReader;
+class FrameFilter;
+
+// frames of varying molecules in one stream: each frame is analyzed by the rules compiled for its composition
+//
+// the composition of a frame is its element symbols in atom order; each composition has a schema built
+// from them (elements of the molecule description first) and an Analyzer of the rules on it, kept in a hash
+// map with the schema swapped into Molecule (see Molecule::SwapSchema) while its frames are read;
+// the least recently used compositions beyond maxSlot are dropped
+class CompositionCache
+{
+public:
+	// rules: text of a rule file, or one rule if ifLine
+	// the schema in Molecule gives the name and the elements of all compositions, and is removed from Molecule
+	CompositionCache(const string & rules, const bool & ifLine, const size_t & maxSlot);
+	~CompositionCache();
+
+	// read the frame after its atom number line of count atoms, only if the comment line passes filter,
+	// else skip the atom lines unparsed; return false if input ends or error is set
+	// warning is set when the frame builds a composition some rules don't apply to, their columns are NaN
+	bool ReadFrame(XyzReader & reader, const int & count, const FrameFilter & filter, bool & ifPass,
+		string & warning, string & error);
+	// Analyzer of the composition of the last frame read
+	inline Analyzer & refAnalyzer() { return *active->analyzer; }
+	// number of schemas built, a frame of a new composition builds one
+	inline long long BuildNum() const { return nBuild; }
+
+private:
+	struct Slot
+	{
+		// empty while in use, the schema is in Molecule then
+		Molecule::Schema schema;
+		std::unique_ptr<Analyzer> analyzer;
+		long long used;
+	};
+
+	string name;
+	std::vector<string> elem_list;
+	string rules;
+	bool ifLine;
+	size_t maxSlot;
+	// compositions by signature, element symbols of the atoms each followed by ' '
+	std::unordered_map<string, Slot> slot;
+	// composition of the schema in Molecule, nullptr for none
+	Slot * active;
+	long long clock;
+	long long nBuild;
+
+	// signature, coordinates and energy of the frame being read
+	string signature;
+	std::vector<double> x;
+	double energy;
+
+	// make the composition of signature active, building it if new
+	bool Use(string & warning, string & error);
+	bool Build(Slot & s, string & warning, string & error);
+	void Release();
+	void Evict();
+};
+
+#endif // !COMPOSITION_H_
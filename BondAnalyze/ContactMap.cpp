@@ -0,0 +1,50 @@
+#include <algorithm>
+#include "ContactMap.h"
+
+using std::vector;
+
+void ContactMap::resize(const int & n)
+{
+	nAtom = n;
+	nWord = (n + 63) / 64;
+	bits.assign(static_cast<size_t>(nAtom) * nWord, 0);
+}
+
+int ContactMap::Coord(const int & i) const
+{
+	const uint64_t * r = row(i);
+	int count = 0;
+	for (int w = 0; w < nWord; ++w)
+		count += Popcount(r[w]);
+	return count;
+}
+
+int ContactMap::Coord(const int & i, const uint64_t * mask) const
+{
+	const uint64_t * r = row(i);
+	int count = 0;
+	for (int w = 0; w < nWord; ++w)
+		count += Popcount(r[w] & mask[w]);
+	return count;
+}
+
+void ContactMap::Symmetrize()
+{
+	for (int i = 0; i < nAtom; ++i) {
+		const uint64_t * r = row(i);
+		for (int w = 0; w < nWord; ++w) {
+			for (uint64_t b = r[w]; b != 0; b &= b - 1) {
+				const int j = (w << 6) + LowBit(b);
+				bits[j * nWord + (i >> 6)] |= uint64_t(1) << (i & 63);
+			}
+		}
+	}
+}
+
+vector<uint64_t> ContactMap::Mask(const int & n, const vector<int> & list)
+{
+	vector<uint64_t> mask((n + 63) / 64, 0);
+	for (const auto & i : list)
+		mask[i >> 6] |= uint64_t(1) << (i & 63);
+	return mask;
+}
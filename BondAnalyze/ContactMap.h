@@ -0,0 +1,73 @@
+#ifndef CONTACTMAP_H_
+#define CONTACTMAP_H_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// count set bits of a word
+inline int Popcount(const uint64_t & w)
+{
+#ifdef _MSC_VER
+	return static_cast<int>(__popcnt64(w));
+#else
+	return __builtin_popcountll(w);
+#endif
+}
+
+// index of the lowest set bit of a nonzero word
+inline int LowBit(const uint64_t & w)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward64(&i, w);
+	return static_cast<int>(i);
+#else
+	return __builtin_ctzll(w);
+#endif
+}
+
+// bit-packed symmetric contact matrix, one bit per atom pair, one row of nWord words per atom
+class ContactMap
+{
+	int nAtom;
+	int nWord;
+	std::vector<uint64_t> bits;
+
+public:
+	ContactMap() :nAtom(0), nWord(0), bits() {}
+
+	void resize(const int & n);
+	inline void clear() { std::fill(bits.begin(), bits.end(), 0); }
+
+	inline void set(const int & i, const int & j) {
+		bits[i * nWord + (j >> 6)] |= uint64_t(1) << (j & 63);
+		bits[j * nWord + (i >> 6)] |= uint64_t(1) << (i & 63);
+	}
+	// set only bit j of row i, see Symmetrize()
+	inline void setHalf(const int & i, const int & j) {
+		bits[i * nWord + (j >> 6)] |= uint64_t(1) << (j & 63);
+	}
+	// set bit (j, i) for each bit (i, j), after setHalf()
+	void Symmetrize();
+	inline bool test(const int & i, const int & j) const {
+		return (bits[i * nWord + (j >> 6)] >> (j & 63)) & 1;
+	}
+
+	inline int wordNum() const { return nWord; }
+	inline const uint64_t * row(const int & i) const { return bits.data() + i * nWord; }
+
+	// number of atoms in contact with atom i
+	int Coord(const int & i) const;
+	// number of atoms in contact with atom i, counting only atoms set in mask (nWord words)
+	int Coord(const int & i, const uint64_t * mask) const;
+
+	// build a row mask of the atoms in list
+	static std::vector<uint64_t> Mask(const int & n, const std::vector<int> & list);
+};
+
+#endif // !CONTACTMAP_H_
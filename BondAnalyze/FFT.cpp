@@ -0,0 +1,47 @@
+#include <cmath>
+#include <utility>
+#include "FFT.h"
+
+using std::complex;
+
+size_t FFTSize(const size_t & n)
+{
+	size_t size = 1;
+	while (size < n)
+		size <<= 1;
+	return size;
+}
+
+void FFT(complex<double> * a, const size_t & n, const bool & inverse)
+{
+	// bit reversal permutation
+	for (size_t i = 1, j = 0; i < n; ++i) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			std::swap(a[i], a[j]);
+	}
+
+	const double pi = std::acos(-1.0);
+	for (size_t len = 2; len <= n; len <<= 1) {
+		const double angle = 2 * pi / len * (inverse ? 1 : -1);
+		const complex<double> wlen(std::cos(angle), std::sin(angle));
+		const size_t half = len >> 1;
+
+		for (size_t i = 0; i < n; i += len) {
+			complex<double> w(1.0, 0.0);
+			for (size_t j = 0; j < half; ++j) {
+				// recompute every 64 steps, so rounding doesn't build up over long transforms
+				if ((j & 63) == 0 && j)
+					w = std::polar(1.0, angle * j);
+				const complex<double> u = a[i + j];
+				const complex<double> v = a[i + j + half] * w;
+				a[i + j] = u + v;
+				a[i + j + half] = u - v;
+				w *= wlen;
+			}
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <complex>
+#include <cstddef>
+
+// in-place radix-2 FFT of n complex values, n a power of 2
+//   forward: A[k] = sum a[j] exp(-2 pi i jk / n)
+//   inverse: a[j] = sum A[k] exp(+2 pi i jk / n), not divided by n
+void FFT(std::complex<double> * a, const size_t & n, const bool & inverse = false);
+
+// smallest power of 2 not less than n
+size_t FFTSize(const size_t & n);
+
+#endif // !FFT_H_
@@ -0,0 +1,76 @@
+#include "Fanout.h"
+#include "XyzReader.h"
+#include "FrameFilter.h"
+
+using std::string;
+using std::vector;
+
+bool Fanout::Add(const string & spec, string & error)
+{
+	std::unique_ptr<Output> out(new Output());
+	if (!out->Parse(spec, error) || !out->Open(error))
+		return false;
+
+	output.push_back(std::move(out));
+	return true;
+}
+
+void Fanout::Compile()
+{
+	molc.reset(new Molecule());
+	Project();
+
+	vector<bool> needContact(Molecule::ContactNum(), false);
+	for (const auto & out : output)
+		out->RequireContact(needContact);
+	molc->UseContact(needContact);
+
+	for (const auto & out : output)
+		out->Compile(molc);
+}
+
+void Fanout::Project()
+{
+	vector<bool> needBondtype(Molecule::nBondtype, false);
+	vector<bool> needAtom(Molecule::totAtom, false);
+	for (const auto & out : output) {
+		out->Require(needBondtype);
+		out->RequireAtom(needAtom);
+	}
+	molc->Project(needBondtype, needAtom);
+}
+
+bool Fanout::ReadFrame(XyzReader & reader)
+{
+	return molc->InputEnergy(reader) && molc->InputX(reader);
+}
+
+bool Fanout::ReadFrame(XyzReader & reader, const FrameFilter & filter, bool & ifPass)
+{
+	const char * b;
+	const char * e;
+	if (!reader.ReadLine(b, e))
+		return false;
+
+	ifPass = filter.Test(b, e);
+	if (!ifPass)
+		return reader.SkipLines(Molecule::totAtom);
+	return molc->InputEnergy(b) && molc->InputX(reader);
+}
+
+void Fanout::Write(const long long & frame)
+{
+	bool ifReproject = false;
+	for (const auto & out : output) {
+		out->Write(frame);
+		ifReproject = ifReproject || out->ifReproject();
+	}
+	if (ifReproject)
+		Project();
+}
+
+void Fanout::Close()
+{
+	for (const auto & out : output)
+		out->Close();
+}
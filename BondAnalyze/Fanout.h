@@ -0,0 +1,39 @@
+#ifndef FANOUT_H_
+#define FANOUT_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "Molecule.h"
+#include "Output.h"
+
+class XyzReader;
+class FrameFilter;
+
+// single pass over a trajectory feeding several Outputs:
+// each frame is parsed once into one Molecule projected to the union of what the outputs need,
+// and each BondType is sorted at most once per frame for all of them
+class Fanout
+{
+	std::vector<std::unique_ptr<Output>> output;
+	std::shared_ptr<Molecule> molc;
+
+	// project the shared Molecule to the union of what the outputs need now
+	void Project();
+
+public:
+	// add an output by spec (see Output), return false and set error if invalid
+	bool Add(const std::string & spec, std::string & error);
+	// create the shared Molecule and write headers, after all outputs are added
+	void Compile();
+
+	// read next frame after its atom number line, return false if input ends
+	bool ReadFrame(XyzReader & reader);
+	// same, but only if the comment line passes filter, else skip the atom lines unparsed
+	bool ReadFrame(XyzReader & reader, const FrameFilter & filter, bool & ifPass);
+	// write current frame to all outputs, frame is its index in input
+	void Write(const long long & frame);
+	void Close();
+};
+
+#endif // !FANOUT_H_
@@ -0,0 +1,16 @@
+#include <cmath>
+#include <Eigen/Geometry>
+#include "FinderAngle.h"
+#include "Molecule.h"
+
+constexpr double RAD2DEG = 180.0 / 3.14159265358979323846;
+
+double FinderAngle::GetBond(Molecule & molc)
+{
+	const Eigen::MatrixXd & X = molc.refX();
+	const Eigen::Vector3d b = X.col(bAtom.GetAtom(molc));
+	const Eigen::Vector3d ba = X.col(aAtom.GetAtom(molc)) - b;
+	const Eigen::Vector3d bc = X.col(cAtom.GetAtom(molc)) - b;
+
+	return std::atan2(ba.cross(bc).norm(), ba.dot(bc)) * RAD2DEG;
+}
@@ -0,0 +1,25 @@
+#ifndef FINDERANGLE_H_
+#define FINDERANGLE_H_
+
+#include "FinderBase.h"
+#include "AtomSelector.h"
+
+// angle a-b-c (degree), b is the vertex
+class FinderAngle : public FinderBase
+{
+	AtomSelector aAtom;
+	AtomSelector bAtom;
+	AtomSelector cAtom;
+
+public:
+	FinderAngle(const AtomSelector & a, const AtomSelector & b, const AtomSelector & c)
+		:aAtom(a), bAtom(b), cAtom(c) {}
+	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const {
+		aAtom.Require(needBondtype);
+		bAtom.Require(needBondtype);
+		cAtom.Require(needBondtype);
+	}
+};
+
+#endif // !FINDERANGLE_H_
@@ -1,30 +1,22 @@
 #ifndef FINDERATOM_H_
 #define FINDERATOM_H_
 
-#include <string>
 #include "FinderBase.h"
+#include "AtomSelector.h"
 
-using std::string;
-
+// distance a-b
 class FinderAtom : public FinderBase
 {
-	int aElem;
-	int bElem;
-	// a atom's iBondType
-	int aBondType;
-	// b atom's iBondType
-	int bBondType;
-	int aBondnum;
-	int bBondnum;
-	bool aSortGreat;
-	bool bSortGreat;
+	AtomSelector aAtom;
+	AtomSelector bAtom;
 
 public:
-	FinderAtom(
-		const string & aE, const string & aiE, const string & ajE, const string & aSort, const int & aNum,
-		const string & bE, const string & biE, const string & bjE, const string & bSort, const int & bNum
-		);
+	FinderAtom(const AtomSelector & a, const AtomSelector & b) :aAtom(a), bAtom(b) {}
 	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const {
+		aAtom.Require(needBondtype);
+		bAtom.Require(needBondtype);
+	}
 };
 
-#endif // !FINDERATOM_H_
\ No newline at end of file
+#endif // !FINDERATOM_H_
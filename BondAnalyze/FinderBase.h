@@ -1,14 +1,29 @@
 #ifndef FINDERBASE_H_
 #define FINDERBASE_H_
 
+#include <iostream>
+#include <vector>
+
 class Molecule;
 
 class FinderBase
 {
 public:
 	virtual double GetBond(Molecule & molc) = 0;
+	// mark the BondTypes needed by GetBond, all by default
+	virtual void Require(std::vector<bool> & needBondtype) const { needBondtype.assign(needBondtype.size(), true); }
+	// mark the contact maps (ids of Molecule::usingContact) needed by GetBond, none by default
+	virtual void RequireContact(std::vector<bool> &) const {}
+	// mark the atoms read by GetBond besides those of its BondTypes, none by default
+	virtual void RequireAtom(std::vector<bool> &) const {}
+	// whether the last GetBond changed what Require / RequireAtom mark, the Molecule is then projected again
+	virtual bool ifReproject() const { return false; }
+	// save / load the state carried across frames, used by checkpoint
+	virtual void SaveState(std::ostream &) {}
+	virtual void LoadState(std::istream &) {}
+	// whether GetBond writes a file besides the result
+	virtual bool ifWriteFile() const { return false; }
 	virtual ~FinderBase() {}
 };
 
 #endif // !FINDERBASE_H_
-
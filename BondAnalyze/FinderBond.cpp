@@ -1,26 +1,19 @@
-#include <vector>
-#include <algorithm>
+#include <stdexcept>
 #include "FinderBond.h"
 #include "Molecule.h"
 
-using std::vector;
-using std::sort;
-
 FinderBond::FinderBond(const string & iE, const string & jE, const string & sort_type, const int & num)
 	:bondnum(num - 1)
 {
 	bondType = Molecule::BondType2Num(Molecule::Elem2Num(iE), Molecule::Elem2Num(jE));
 	sortGreat = (sort_type == "max") ? true : false;
+
+	if (bondnum < 0 || bondnum >= Molecule::nBond[bondType])
+		throw std::invalid_argument("bond num: " + std::to_string(num) + " out of range!");
+	Molecule::usingRank(bondType, bondnum, sortGreat);
 }
 
 double FinderBond::GetBond(Molecule & molc)
 {
-	vector<Molecule::Bond> bond = molc.refBond()[bondType];
-	
-	if (sortGreat)
-		sort(bond.begin(), bond.end(), std::greater<Molecule::Bond>());
-	else
-		sort(bond.begin(), bond.end());
-
-	return bond[bondnum].getLen();
-}
\ No newline at end of file
+	return molc.RankedLen(bondType, bondnum, sortGreat);
+}
@@ -17,6 +17,7 @@ public:
 		const string & iE, const string & jE, const string & sort_type, const int & num
 	);
 	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const { needBondtype[bondType] = true; }
 };
 
 #endif // !FINDERBOND_H_
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+#include "FinderContact.h"
+#include "Molecule.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+FinderContact::FinderContact(const string & iE, const string & jE, const double & rcut, const string & delta_file)
+	:delta_file(delta_file), frame(0), delta_offset(-1)
+{
+	iElem = Molecule::Elem2Num(iE);
+	jElem = Molecule::Elem2Num(jE);
+	iContact = Molecule::usingContact(rcut);
+	jMask = ContactMap::Mask(Molecule::totAtom, Molecule::atomTravlist[jElem]);
+
+	if (!delta_file.empty())
+		prev.assign(Molecule::atomTravlist[iElem].size() * jMask.size(), 0);
+}
+
+void FinderContact::Require(std::vector<bool> & needBondtype) const
+{
+	const int iBondtype = Molecule::FindBondType(iElem, jElem);
+	if (iBondtype >= 0)
+		needBondtype[iBondtype] = true;
+}
+
+void FinderContact::OpenDelta()
+{
+	if (delta_offset < 0) {
+		delta.open(delta_file.c_str(), std::ofstream::out | std::ofstream::binary);
+	}
+	else {
+		// drop the records written after the checkpoint
+		if (truncate(delta_file.c_str(), delta_offset) == 0)
+			delta.open(delta_file.c_str(), std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+	}
+
+	if (!delta) {
+		cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+		cerr << "delta file: " << delta_file << " open failed!" << endl;
+		exit(1);
+	}
+}
+
+double FinderContact::GetBond(Molecule & molc)
+{
+	const ContactMap & cmap = molc.refContactMap(iContact);
+	const vector<int> & iAtoms = Molecule::atomTravlist[iElem];
+	const int nWord = cmap.wordNum();
+
+	int count = 0;
+	for (const auto & i : iAtoms)
+		count += cmap.Coord(i, jMask.data());
+
+	// same element pairs are counted from both ends
+	if (iElem == jElem)
+		count /= 2;
+
+	if (!delta_file.empty()) {
+		if (!delta.is_open())
+			OpenDelta();
+
+		// record = 2 words: (iAtom, iWord), xor; at most one record per changed word
+		uint64_t * record = molc.refArena().Alloc<uint64_t>(2 * prev.size() + 1);
+		int32_t * head = reinterpret_cast<int32_t *>(record);
+		int32_t nChange = 0;
+
+		for (size_t k = 0; k < iAtoms.size(); ++k) {
+			const uint64_t * r = cmap.row(iAtoms[k]);
+			for (int w = 0; w < nWord; ++w) {
+				const uint64_t cur = r[w] & jMask[w];
+				uint64_t & old = prev[k * nWord + w];
+				if (cur != old) {
+					int32_t * ij = reinterpret_cast<int32_t *>(record + 1 + 2 * nChange);
+					ij[0] = iAtoms[k];
+					ij[1] = w;
+					record[2 + 2 * nChange] = cur ^ old;
+					old = cur;
+					nChange++;
+				}
+			}
+		}
+
+		if (nChange > 0) {
+			head[0] = frame;
+			head[1] = nChange;
+			delta.write(reinterpret_cast<const char *>(record), (1 + 2 * nChange) * sizeof(uint64_t));
+		}
+	}
+	frame++;
+
+	return count;
+}
+
+void FinderContact::SaveState(std::ostream & os)
+{
+	if (delta_file.empty())
+		return;
+
+	long long offset = delta_offset;
+	if (delta.is_open()) {
+		delta.flush();
+		offset = delta.tellp();
+	}
+
+	os.write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+	os.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+	os.write(reinterpret_cast<const char *>(prev.data()), prev.size() * sizeof(uint64_t));
+}
+
+void FinderContact::LoadState(std::istream & is)
+{
+	if (delta_file.empty())
+		return;
+
+	is.read(reinterpret_cast<char *>(&frame), sizeof(frame));
+	is.read(reinterpret_cast<char *>(&delta_offset), sizeof(delta_offset));
+	is.read(reinterpret_cast<char *>(prev.data()), prev.size() * sizeof(uint64_t));
+
+	// reopened at delta_offset on next frame
+	if (delta.is_open())
+		delta.close();
+}
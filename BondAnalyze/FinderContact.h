@@ -0,0 +1,47 @@
+#ifndef FINDERCONTACT_H_
+#define FINDERCONTACT_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "FinderBase.h"
+
+using std::string;
+
+// number of iE-jE pairs within rcut
+//
+// optionally writes the changes of the iE-jE contacts between consecutive frames to a binary delta file,
+// one record per frame with changes (the first frame is compared with an empty map):
+//   int32 frame, int32 nChange, nChange * { int32 iAtom, int32 iWord, uint64 xor }
+// bit b of xor flips the contact between iAtom (an iE atom) and atom 64 * iWord + b (a jE atom)
+// only the delta file carries state across frames, a rule without it saves none
+class FinderContact : public FinderBase
+{
+	int iElem;
+	int jElem;
+	int iContact;
+	std::vector<uint64_t> jMask;
+
+	string delta_file;
+	std::ofstream delta;
+	int frame;
+	// size of delta file to keep when resumed from checkpoint, -1 for a new file
+	long long delta_offset;
+	// iE rows of the previous frame, masked by jMask
+	std::vector<uint64_t> prev;
+
+public:
+	FinderContact(const string & iE, const string & jE, const double & rcut, const string & delta_file = "");
+	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const;
+	virtual void RequireContact(std::vector<bool> & needContact) const { needContact[iContact] = true; }
+	virtual void SaveState(std::ostream & os);
+	virtual void LoadState(std::istream & is);
+	virtual bool ifWriteFile() const { return !delta_file.empty(); }
+
+private:
+	void OpenDelta();
+};
+
+#endif // !FINDERCONTACT_H_
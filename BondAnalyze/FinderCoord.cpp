@@ -0,0 +1,24 @@
+#include "FinderCoord.h"
+#include "Molecule.h"
+
+FinderCoord::FinderCoord(const AtomSelector & a, const string & nE, const double & rcut)
+	:atom(a)
+{
+	nElem = Molecule::Elem2Num(nE);
+	iContact = Molecule::usingContact(rcut);
+	mask = ContactMap::Mask(Molecule::totAtom, Molecule::atomTravlist[nElem]);
+}
+
+void FinderCoord::Require(std::vector<bool> & needBondtype) const
+{
+	atom.Require(needBondtype);
+
+	const int iBondtype = Molecule::FindBondType(atom.Elem(), nElem);
+	if (iBondtype >= 0)
+		needBondtype[iBondtype] = true;
+}
+
+double FinderCoord::GetBond(Molecule & molc)
+{
+	return molc.refContactMap(iContact).Coord(atom.GetAtom(molc), mask.data());
+}
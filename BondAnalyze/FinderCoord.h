@@ -0,0 +1,27 @@
+#ifndef FINDERCOORD_H_
+#define FINDERCOORD_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "FinderBase.h"
+#include "AtomSelector.h"
+
+using std::string;
+
+// coordination number: number of nE atoms within rcut of the selected atom
+class FinderCoord : public FinderBase
+{
+	AtomSelector atom;
+	int nElem;
+	int iContact;
+	std::vector<uint64_t> mask;
+
+public:
+	FinderCoord(const AtomSelector & a, const string & nE, const double & rcut);
+	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const;
+	virtual void RequireContact(std::vector<bool> & needContact) const { needContact[iContact] = true; }
+};
+
+#endif // !FINDERCOORD_H_
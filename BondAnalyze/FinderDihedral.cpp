@@ -0,0 +1,19 @@
+#include <cmath>
+#include <Eigen/Geometry>
+#include "FinderDihedral.h"
+#include "Molecule.h"
+
+constexpr double RAD2DEG = 180.0 / 3.14159265358979323846;
+
+double FinderDihedral::GetBond(Molecule & molc)
+{
+	const Eigen::MatrixXd & X = molc.refX();
+	const Eigen::Vector3d b1 = X.col(bAtom.GetAtom(molc)) - X.col(aAtom.GetAtom(molc));
+	const Eigen::Vector3d b2 = X.col(cAtom.GetAtom(molc)) - X.col(bAtom.GetAtom(molc));
+	const Eigen::Vector3d b3 = X.col(dAtom.GetAtom(molc)) - X.col(cAtom.GetAtom(molc));
+
+	const Eigen::Vector3d n1 = b1.cross(b2);
+	const Eigen::Vector3d n2 = b2.cross(b3);
+
+	return std::atan2(b2.norm() * b1.dot(n2), n1.dot(n2)) * RAD2DEG;
+}
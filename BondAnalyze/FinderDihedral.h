@@ -0,0 +1,27 @@
+#ifndef FINDERDIHEDRAL_H_
+#define FINDERDIHEDRAL_H_
+
+#include "FinderBase.h"
+#include "AtomSelector.h"
+
+// dihedral a-b-c-d (degree, -180 ~ 180), around the b-c axis
+class FinderDihedral : public FinderBase
+{
+	AtomSelector aAtom;
+	AtomSelector bAtom;
+	AtomSelector cAtom;
+	AtomSelector dAtom;
+
+public:
+	FinderDihedral(const AtomSelector & a, const AtomSelector & b, const AtomSelector & c, const AtomSelector & d)
+		:aAtom(a), bAtom(b), cAtom(c), dAtom(d) {}
+	virtual double GetBond(Molecule & molc);
+	virtual void Require(std::vector<bool> & needBondtype) const {
+		aAtom.Require(needBondtype);
+		bAtom.Require(needBondtype);
+		cAtom.Require(needBondtype);
+		dAtom.Require(needBondtype);
+	}
+};
+
+#endif // !FINDERDIHEDRAL_H_
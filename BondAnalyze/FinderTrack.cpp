@@ -0,0 +1,104 @@
+#include <stdexcept>
+#include <algorithm>
+#include "FinderTrack.h"
+#include "Molecule.h"
+
+FinderTrack::FinderTrack(const string & iE, const string & jE, const string & sort_type, const int & num, const long long & ref)
+	:bondnum(num - 1), refFrame(ref), frame(0), pair()
+{
+	iElem = Molecule::Elem2Num(iE);
+	bondType = Molecule::BondType2Num(iElem, Molecule::Elem2Num(jE));
+	sortGreat = (sort_type == "max") ? true : false;
+
+	if (bondnum < 0 || bondnum >= Molecule::nBond[bondType])
+		throw std::invalid_argument("bond num: " + std::to_string(num) + " out of range!");
+	if (refFrame < 0)
+		throw std::invalid_argument("reference frame: " + std::to_string(ref) + " out of range!");
+	Molecule::usingRank(bondType, bondnum, sortGreat);
+}
+
+double FinderTrack::GetBond(Molecule & molc)
+{
+	if (frame < refFrame) {
+		frame++;
+		return molc.RankedLen(bondType, bondnum, sortGreat);
+	}
+
+	if (frame == refFrame) {
+		frame++;
+		pair.resize(bondnum + 1);
+		for (int num = 0; num <= bondnum; ++num) {
+			const Molecule::Bond b = molc.RankedBond(bondType, num, sortGreat);
+			pair[num] = { b.getAtom(iElem), b.getOtherAtom(iElem), b.getLen() };
+		}
+		return pair[bondnum].len;
+	}
+
+	frame++;
+	const Eigen::MatrixXd & X = molc.refX();
+	for (auto & p : pair)
+		p.len = (X.col(p.iAtom) - X.col(p.jAtom)).norm();
+
+	// re-rank only from the first kept pair that passed the one before it,
+	// by insertion sort: pairs of equal length keep their order, no heap
+	auto before = [this](const Pair & a, const Pair & b) { return sortGreat ? a.len > b.len : a.len < b.len; };
+	size_t first = 1;
+	while (first < pair.size() && !before(pair[first], pair[first - 1]))
+		++first;
+	for (size_t i = first; i < pair.size(); ++i) {
+		const Pair p = pair[i];
+		size_t j = i;
+		for (; j > 0 && before(p, pair[j - 1]); --j)
+			pair[j] = pair[j - 1];
+		pair[j] = p;
+	}
+	return pair[bondnum].len;
+}
+
+void FinderTrack::Require(std::vector<bool> & needBondtype) const
+{
+	if (frame <= refFrame)
+		needBondtype[bondType] = true;
+}
+
+void FinderTrack::RequireAtom(std::vector<bool> & needAtom) const
+{
+	for (const auto & p : pair) {
+		needAtom[p.iAtom] = true;
+		needAtom[p.jAtom] = true;
+	}
+}
+
+void FinderTrack::SaveState(std::ostream & os)
+{
+	const int n = static_cast<int>(pair.size());
+	os.write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+	os.write(reinterpret_cast<const char *>(&n), sizeof(n));
+	for (const auto & p : pair) {
+		os.write(reinterpret_cast<const char *>(&p.iAtom), sizeof(p.iAtom));
+		os.write(reinterpret_cast<const char *>(&p.jAtom), sizeof(p.jAtom));
+	}
+}
+
+void FinderTrack::LoadState(std::istream & is)
+{
+	int n = 0;
+	is.read(reinterpret_cast<char *>(&frame), sizeof(frame));
+	is.read(reinterpret_cast<char *>(&n), sizeof(n));
+	// no pairs before the reference frame, bondnum + 1 after it; anything else is a bad state
+	if (!is || frame < 0 || n != ((frame > refFrame) ? bondnum + 1 : 0)) {
+		is.setstate(std::ios::failbit);
+		pair.clear();
+		return;
+	}
+	pair.assign(n, Pair{ 0, 0, 0.0 });
+	for (auto & p : pair) {
+		is.read(reinterpret_cast<char *>(&p.iAtom), sizeof(p.iAtom));
+		is.read(reinterpret_cast<char *>(&p.jAtom), sizeof(p.jAtom));
+		if (p.iAtom < 0 || p.iAtom >= Molecule::totAtom || p.jAtom < 0 || p.jAtom >= Molecule::totAtom) {
+			is.setstate(std::ios::failbit);
+			pair.clear();
+			return;
+		}
+	}
+}
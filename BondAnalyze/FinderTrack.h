@@ -0,0 +1,52 @@
+#ifndef FINDERTRACK_H_
+#define FINDERTRACK_H_
+
+#include <string>
+#include <vector>
+#include "FinderBase.h"
+
+using std::string;
+
+// bond iE jE min/max num, following the atoms of the bonds instead of ranking every frame
+//
+// at the reference frame (counted from 0 among the frames analyzed) the atom pairs of the num shortest (longest)
+// iE-jE bonds are kept; later frames take the distances of only these pairs from the coordinates, without sorting
+// the bonds, and give the num-th of them; their order is checked each frame and re-solved only when two of them
+// have swapped, so the value follows the same pair until another kept pair passes it
+// frames before the reference are ranked as by bond
+// the iE-jE BondType is required up to the reference frame only; after it the rule needs just the atoms of the
+// kept pairs, and the Molecule is projected again (see ifReproject) so the BondType is no longer calculated
+// unless another rule needs it
+class FinderTrack : public FinderBase
+{
+	struct Pair
+	{
+		int iAtom;
+		int jAtom;
+		double len;
+	};
+
+	int iElem;
+	int bondType;
+	int bondnum;
+	bool sortGreat;
+	long long refFrame;
+	long long frame;
+	// kept pairs in the order of their ranks
+	std::vector<Pair> pair;
+
+public:
+	FinderTrack(
+		const string & iE, const string & jE, const string & sort_type, const int & num, const long long & ref
+	);
+	virtual double GetBond(Molecule & molc);
+	// the BondType up to the reference frame, then the atoms of the kept pairs, see above
+	virtual void Require(std::vector<bool> & needBondtype) const;
+	virtual void RequireAtom(std::vector<bool> & needAtom) const;
+	// right after the reference frame
+	virtual bool ifReproject() const { return frame == refFrame + 1; }
+	virtual void SaveState(std::ostream & os);
+	virtual void LoadState(std::istream & is);
+};
+
+#endif // !FINDERTRACK_H_
@@ -0,0 +1,120 @@
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "FrameFilter.h"
+
+static inline bool IsBlank(const char & c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool FrameFilter::Add(const string & expr, string & error)
+{
+	std::istringstream sin(expr);
+	string item;
+	while (getline(sin, item, ',')) {
+		// field, operator, number; blanks allowed around the operator
+		string s;
+		for (const auto & c : item) {
+			if (!IsBlank(c))
+				s.push_back(c);
+		}
+		if (s.empty())
+			continue;
+
+		const auto pos = s.find_first_of("<>=!");
+		if (pos == 0 || pos == string::npos) {
+			error = "invalid frame predicate: " + item;
+			return false;
+		}
+
+		Cond c;
+		const string field = s.substr(0, pos);
+		string rest = s.substr(pos);
+
+		static const struct { const char * text; Op op; } OPS[] = {
+			{ "<=", LE }, { ">=", GE }, { "==", EQ }, { "!=", NE }, { "<", LT }, { ">", GT }
+		};
+		bool found = false;
+		for (const auto & o : OPS) {
+			if (rest.compare(0, strlen(o.text), o.text) == 0) {
+				c.op = o.op;
+				rest.erase(0, strlen(o.text));
+				found = true;
+				break;
+			}
+		}
+
+		char * stop;
+		c.value = strtod(rest.c_str(), &stop);
+		if (!found || rest.empty() || *stop != '\0') {
+			error = "invalid frame predicate: " + item;
+			return false;
+		}
+
+		if (field[0] == '$') {
+			c.index = atoi(field.c_str() + 1);
+			if (c.index < 1) {
+				error = "invalid field of frame predicate: " + item;
+				return false;
+			}
+		}
+		else {
+			c.index = 0;
+			c.name = field;
+		}
+		cond.push_back(c);
+	}
+	return true;
+}
+
+bool FrameFilter::Test(const char * b, const char * e) const
+{
+	for (const auto & c : cond) {
+		// find the token of the field
+		const char * p = b;
+		const char * value = nullptr;
+		int index = 0;
+		while (p < e && !value) {
+			while (p < e && IsBlank(*p))
+				++p;
+			if (p == e)
+				break;
+			const char * token = p;
+			while (p < e && !IsBlank(*p))
+				++p;
+			++index;
+
+			if (c.index > 0) {
+				if (index == c.index)
+					value = token;
+			}
+			else if (static_cast<size_t>(p - token) > c.name.size() &&
+				token[c.name.size()] == '=' && memcmp(token, c.name.data(), c.name.size()) == 0) {
+				value = token + c.name.size() + 1;
+			}
+		}
+		if (!value)
+			return false;
+
+		// the line ends with a sentinel, see XyzReader::ReadLine
+		char * stop;
+		const double v = strtod(value, &stop);
+		if (stop == value)
+			return false;
+
+		bool pass = false;
+		switch (c.op)
+		{
+		case LT: pass = v < c.value; break;
+		case LE: pass = v <= c.value; break;
+		case GT: pass = v > c.value; break;
+		case GE: pass = v >= c.value; break;
+		case EQ: pass = v == c.value; break;
+		case NE: pass = v != c.value; break;
+		}
+		if (!pass)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef FRAMEFILTER_H_
+#define FRAMEFILTER_H_
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+class XyzReader;
+
+// predicate on the comment line of a frame: comparisons joined by ',', all must hold
+//   <field> <op> <number>     op: < <= > >= == !=
+//   field: $N for the N-th (from 1) token separated by blanks, or a name for the value of a name=value token
+// the energy is $1, e.g. "$1>=-76.5,$1<-76.4" or "step>=1000"
+// a frame whose field is missing or not a number fails
+class FrameFilter
+{
+	enum Op { LT, LE, GT, GE, EQ, NE };
+
+	struct Cond
+	{
+		// token index from 1, 0 for a named field
+		int index;
+		string name;
+		Op op;
+		double value;
+	};
+
+	std::vector<Cond> cond;
+
+public:
+	// add the comparisons of expr, return false and set error if invalid
+	bool Add(const string & expr, string & error);
+
+	inline bool ifActive() const { return !cond.empty(); }
+	// whether comment line [b, e) passes
+	bool Test(const char * b, const char * e) const;
+};
+
+#endif // !FRAMEFILTER_H_
@@ -1,6 +1,15 @@
 #include "Molecule.h"
+#include "XyzReader.h"
+#include "RadixSort.h"
+#include "ThreadPool.h"
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <thread>
 
 using namespace Eigen;
 using std::vector;
@@ -12,6 +21,8 @@ using std::ostringstream;
 using std::endl;
 using std::cerr;
 
+std::ofstream debug;
+
 // ---------- define static member variable ----------
 string Molecule::name;
 
@@ -32,11 +43,52 @@ Molecule::bdtype2int Molecule::bdtype2num;
 Molecule::int2bdtype Molecule::num2bdtype;
 vector<int> Molecule::nBond;
 vector<vector<Molecule::Array2>> Molecule::bondTravlist;
+vector<bool> Molecule::ifCompact;
 
 bool Molecule::ifString = false;
 bool Molecule::ifVectorR = false;
 bool Molecule::ifMatrixR = false;
 bool Molecule::ifBond = false;
+vector<double> Molecule::contact_rcut;
+int Molecule::compactMin = 100000;
+int Molecule::nThread = 0;
+bool Molecule::ifStream = false;
+bool Molecule::ifSquared = false;
+vector<int> Molecule::rankMinNum;
+vector<int> Molecule::rankMaxNum;
+vector<bool> Molecule::keepLens;
+
+// cost model of parallel frames, in bonds of a frame:
+// below PARALLEL_MIN waking the threads costs more than the work they share
+constexpr long long PARALLEL_MIN = 1 << 16;
+// bonds of a CalcBond tile, small enough that the coordinates it reads stay in L1/L2
+constexpr int TILE_BOND = 1 << 12;
+// a single BondType of at least PARALLEL_SORT_MIN bonds is sorted by parts
+constexpr int PARALLEL_SORT_MIN = 1 << 18;
+// a stream frame calculates a row of bonds TILE_ATOM atoms at a time, into a buffer on the stack
+constexpr int TILE_ATOM = 1 << 10;
+// rows of a stream frame are split into chunks of about STREAM_CHUNK bonds, the tasks of a parallel frame
+constexpr int STREAM_CHUNK = 1 << 16;
+
+// a BondType is a triangle of rows of the same element, or a rectangle of rows of iElem and columns of jElem;
+// first bond of row r
+static inline long long RowBase(const bool & same, const int & nCol, const int & r)
+{
+	return same ? static_cast<long long>(r) * (nCol - 1) - static_cast<long long>(r) * (r - 1) / 2
+		: static_cast<long long>(r) * nCol;
+}
+
+ThreadPool & Molecule::Pool()
+{
+	// created at the first parallel frame
+	static ThreadPool pool(nThread > 0 ? nThread : static_cast<int>(std::thread::hardware_concurrency()));
+	return pool;
+}
+
+inline bool Molecule::ifParallel() const
+{
+	return nThread != 1 && nActiveBond >= PARALLEL_MIN;
+}
 
 // =============== construct =============== 
 
@@ -50,6 +102,9 @@ Molecule::Molecule()
 	if (ifString)
 		atom_str.resize(totAtom);
 
+	ifActiveBondtype.assign(nBondtype, true);
+	ifActiveAtom.assign(totAtom, true);
+
 	if (ifVectorR)
 		vectorR.resize(totAtom * (totAtom - 1) / 2);
 
@@ -57,11 +112,31 @@ Molecule::Molecule()
 		matrixR.resize(totAtom, totAtom);
 
 	if (ifBond) {
+		ifSorted.assign(nBondtype, false);
 		bond.resize(nBondtype);
-		for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
-			bond[iBondtype].resize(nBond[iBondtype]);
+		bondKey.resize(nBondtype);
+		bondIdx.resize(nBondtype);
+		rankMin.resize(nBondtype);
+		rankMax.resize(nBondtype);
+		streamLens.assign(nBondtype, nullptr);
+		for (int iBondtype = 0; iBondtype < nBondtype && !ifStream; ++iBondtype) {
+			if (ifCompact[iBondtype]) {
+				bondKey[iBondtype].resize(nBond[iBondtype]);
+				bondIdx[iBondtype].resize(nBond[iBondtype]);
+			}
+			else if (nBond[iBondtype] > 0) {
+				// elements are the same for all bonds of a BondType, set once: Bond::assign sets only atoms and length
+				const Array2 & ij = bondTravlist[iBondtype][0];
+				bond[iBondtype].assign(nBond[iBondtype], Bond(0.0, ij.iAtom, ij.jAtom));
+			}
 		}
+
+		// contact maps are allocated by UseContact()
+		ifContact.assign(contact_rcut.size(), false);
+		contact.resize(contact_rcut.size());
 	}
+
+	BuildTile();
 }
 // =========================================
 
@@ -120,7 +195,7 @@ void Molecule::InputInfo(istream & fin)
 		}
 	}
 
-	atomTravlist.resize(nElem, vector<int>());
+	atomTravlist.assign(nElem, vector<int>());
 	for (int iAtom = 0; iAtom < totAtom; ++iAtom) {
 		atomTravlist[atom_list[iAtom]].push_back(iAtom);
 	}
@@ -155,6 +230,29 @@ void Molecule::InputInfo(istream & fin)
 		BondInfo();
 }
 
+void Molecule::SwapSchema(Schema & s)
+{
+	using std::swap;
+
+	swap(name, s.name);
+	swap(nElem, s.nElem);
+	swap(elem_list, s.elem_list);
+	swap(elem2num, s.elem2num);
+	swap(num2elem, s.num2elem);
+	swap(totAtom, s.totAtom);
+	swap(nAtom, s.nAtom);
+	swap(atom_list, s.atom_list);
+	swap(atomTravlist, s.atomTravlist);
+	swap(totBond, s.totBond);
+	swap(nBondtype, s.nBondtype);
+	swap(bondtype_list, s.bondtype_list);
+	swap(bdtype2num, s.bdtype2num);
+	swap(num2bdtype, s.num2bdtype);
+	swap(nBond, s.nBond);
+	swap(bondTravlist, s.bondTravlist);
+	swap(ifCompact, s.ifCompact);
+}
+
 void Molecule::BondInfo()
 {
 	totBond = (totAtom * (totAtom - 1)) / 2;
@@ -185,7 +283,7 @@ void Molecule::BondInfo()
 		if (nAtom[iE] > 1) {
 			nBond.push_back((nAtom[iE] * (nAtom[iE] - 1)) / 2);
 			bondTravlist.push_back(vector<Array2>());
-			for (int i = 0; i < nAtom[iE] - 1; ++i) {
+			for (int i = 0; i < nAtom[iE] - 1 && !ifStream; ++i) {
 				for (int j = i + 1; j < nAtom[iE]; ++j) {
 					bondTravlist[iBondtype].push_back(Array2(atomTravlist[iE][i], atomTravlist[iE][j]));
 				}
@@ -195,7 +293,7 @@ void Molecule::BondInfo()
 		for (int jE = iE + 1; jE < nElem; ++jE) {
 			nBond.push_back(nAtom[iE] * nAtom[jE]);
 			bondTravlist.push_back(vector<Array2>());
-			for (int i = 0; i < nAtom[iE]; ++i) {
+			for (int i = 0; i < nAtom[iE] && !ifStream; ++i) {
 				for (int j = 0; j < nAtom[jE]; ++j) {
 					bondTravlist[iBondtype].push_back(Array2(atomTravlist[iE][i], atomTravlist[jE][j]));
 				}
@@ -204,6 +302,11 @@ void Molecule::BondInfo()
 		}
 	}
 
+	ifCompact.resize(nBondtype);
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		ifCompact[iBondtype] = (nBond[iBondtype] >= compactMin);
+	}
+
 #ifdef DEBUG_MOLECULE
 
 	debug << "totBond: " << totBond << endl;
@@ -232,12 +335,85 @@ void Molecule::BondInfo()
 
 }
 
+int Molecule::usingContact(const double & rcut)
+{
+	usingBond();
+
+	for (size_t i = 0; i < contact_rcut.size(); ++i) {
+		if (contact_rcut[i] == rcut)
+			return static_cast<int>(i);
+	}
+	contact_rcut.push_back(rcut);
+	return static_cast<int>(contact_rcut.size()) - 1;
+}
+
+void Molecule::usingRank(const int & iBondtype, const int & num, const bool & sortGreat)
+{
+	vector<int> & rankNum = sortGreat ? rankMaxNum : rankMinNum;
+	if (static_cast<int>(rankNum.size()) < nBondtype)
+		rankNum.resize(nBondtype, 0);
+	rankNum[iBondtype] = std::max(rankNum[iBondtype], num + 1);
+}
+
+void Molecule::usingLens(const int & iBondtype)
+{
+	if (static_cast<int>(keepLens.size()) < nBondtype)
+		keepLens.resize(nBondtype, false);
+	keepLens[iBondtype] = true;
+}
+
+void Molecule::UseContact(const vector<bool> & needContact)
+{
+	ifContact.assign(contact_rcut.size(), false);
+	contact.resize(contact_rcut.size());
+	activeContact.clear();
+	for (int iContact = 0; iContact < static_cast<int>(contact.size()); ++iContact) {
+		if (iContact < static_cast<int>(needContact.size()) && needContact[iContact]) {
+			contact[iContact].resize(totAtom);
+			activeContact.push_back(iContact);
+		}
+		else {
+			contact[iContact] = ContactMap();
+		}
+	}
+}
+
+void Molecule::Project(const vector<bool> & needBondtype, const vector<bool> & needAtom)
+{
+	ifActiveBondtype = needBondtype;
+	ifActiveAtom.assign(totAtom, false);
+	for (size_t iAtom = 0; iAtom < needAtom.size(); ++iAtom) {
+		if (needAtom[iAtom])
+			ifActiveAtom[iAtom] = true;
+	}
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		if (!ifActiveBondtype[iBondtype])
+			continue;
+		for (const auto & iE : { bondtype_list[iBondtype].iElem, bondtype_list[iBondtype].jElem }) {
+			for (const auto & iAtom : atomTravlist[iE])
+				ifActiveAtom[iAtom] = true;
+		}
+	}
+	BuildTile();
+
+#ifdef DEBUG_MOLECULE
+	debug << "active BondType: ";
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		if (ifActiveBondtype[iBondtype])
+			debug << bondtype_list[iBondtype] << ' ';
+	}
+	debug << endl;
+#endif // DEBUG_MOLECULE
+}
+
 // ======================================================
 // =================== input function ===================
 // ======================================================
 
 void Molecule::InputX(std::istream & fin)
 {
+	arena.Reset();
+
 	string elem;
 	for (int i = 0; i < totAtom; ++i) {
 		fin >> elem;
@@ -247,17 +423,84 @@ void Molecule::InputX(std::istream & fin)
 		}
 	}
 
+	CalcFrame();
+}
+
+bool Molecule::InputEnergy(XyzReader & reader)
+{
+	const char * b;
+	const char * e;
+	if (!reader.ReadLine(b, e))
+		return false;
+
+	return InputEnergy(b);
+}
+
+bool Molecule::InputEnergy(const char * comment)
+{
+	char * stop;
+	Energy = strtod(comment, &stop);
+	return stop != comment;
+}
+
+bool Molecule::InputX(XyzReader & reader)
+{
+	arena.Reset();
+
+	const char * b;
+	const char * e;
+	for (int i = 0; i < totAtom; ++i) {
+		if (!reader.ReadLine(b, e))
+			return false;
+		if (!ifActiveAtom[i])
+			continue;
+
+		// skip element
+		while (b < e && (*b == ' ' || *b == '\t'))
+			++b;
+		while (b < e && *b != ' ' && *b != '\t')
+			++b;
+
+		char * stop;
+		for (int j = 0; j < 3; ++j) {
+			X(j, i) = strtod(b, &stop);
+			b = stop;
+		}
+	}
+
+	CalcFrame();
+
+	return true;
+}
+
+void Molecule::InputX(const double * x)
+{
+	arena.Reset();
+
+	X = Map<const MatrixXd>(x, 3, totAtom);
+
+	CalcFrame();
+}
+
+void Molecule::CalcFrame()
+{
 	if (ifVectorR)
 		CalcVectorR();
 	if (ifMatrixR)
 		CalcMatrixR();
-	if (ifBond)
-		CalcBond();
+	if (ifBond) {
+		if (ifStream)
+			CalcStream();
+		else
+			CalcBond();
+	}
 }
 
 std::istream & operator >> (std::istream & fin, Molecule & m)
 {
 	using std::getline;
+
+	m.arena.Reset();
 	
 	string line;
 	string elem;
@@ -276,31 +519,106 @@ std::istream & operator >> (std::istream & fin, Molecule & m)
 		}
 	}
 
-	if (m.ifVectorR)
-		m.CalcVectorR();
-	if (m.ifMatrixR)
-		m.CalcMatrixR();
-	if (m.ifBond)
-		m.CalcBond();
+	m.CalcFrame();
 
 	return fin;
 }
 
-void Molecule::CalcBond()
+void Molecule::BuildTile()
 {
+	nActiveBond = 0;
+	tileBondtype.clear();
+	tileBegin.clear();
+	chunkFirst.assign(nBondtype + 1, 0);
+	chunkBegin.clear();
+	chunkEnd.clear();
+	if (!ifBond)
+		return;
+
+	if (ifStream) {
+		for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+			chunkFirst[iBondtype] = static_cast<int>(chunkBegin.size());
+			if (!ifActiveBondtype[iBondtype])
+				continue;
+			nActiveBond += nBond[iBondtype];
+
+			const BondType & type = bondtype_list[iBondtype];
+			const bool same = (type.iElem == type.jElem);
+			const int nCol = nAtom[type.jElem];
+			const int nRow = same ? nCol - 1 : nAtom[type.iElem];
+			int begin = 0;
+			for (int r = 0; r < nRow; ++r) {
+				if (RowBase(same, nCol, r + 1) - RowBase(same, nCol, begin) >= STREAM_CHUNK || r == nRow - 1) {
+					chunkBegin.push_back(begin);
+					chunkEnd.push_back(r + 1);
+					begin = r + 1;
+				}
+			}
+		}
+		chunkFirst[nBondtype] = static_cast<int>(chunkBegin.size());
+		chunkMin.resize(chunkBegin.size());
+		chunkMax.resize(chunkBegin.size());
+		return;
+	}
+
 	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
-		for (int iBond = 0; iBond < nBond[iBondtype]; ++iBond) {
+		if (!ifActiveBondtype[iBondtype])
+			continue;
+		nActiveBond += nBond[iBondtype];
+		for (int begin = 0; begin < nBond[iBondtype]; begin += TILE_BOND) {
+			tileBondtype.push_back(iBondtype);
+			tileBegin.push_back(begin);
+		}
+	}
+}
+
+void Molecule::CalcBondRange(const int & iBondtype, const int & begin, const int & end)
+{
+	if (ifCompact[iBondtype]) {
+		double * key = bondKey[iBondtype].data();
+		int * idx = bondIdx[iBondtype].data();
+		for (int iBond = begin; iBond < end; ++iBond) {
+			const auto & ij = bondTravlist[iBondtype][iBond];
+			key[iBond] = ifSquared ? (X.col(ij.iAtom) - X.col(ij.jAtom)).squaredNorm() : (X.col(ij.iAtom) - X.col(ij.jAtom)).norm();
+			idx[iBond] = iBond;
+		}
+	}
+	else {
+		for (int iBond = begin; iBond < end; ++iBond) {
 			const auto & ij = bondTravlist[iBondtype][iBond];
-			bond[iBondtype][iBond].assign((X.col(ij.iAtom) - X.col(ij.jAtom)).norm(), ij.iAtom, ij.jAtom);
+			const double len = ifSquared ? (X.col(ij.iAtom) - X.col(ij.jAtom)).squaredNorm() : (X.col(ij.iAtom) - X.col(ij.jAtom)).norm();
+			bond[iBondtype][iBond].assign(len, ij.iAtom, ij.jAtom);
 		}
 	}
+}
+
+void Molecule::CalcBond()
+{
+	if (ifParallel()) {
+		Pool().ParallelFor(static_cast<int>(tileBondtype.size()), [this](int t) {
+			const int iBondtype = tileBondtype[t];
+			CalcBondRange(iBondtype, tileBegin[t], std::min(tileBegin[t] + TILE_BOND, nBond[iBondtype]));
+		});
+	}
+	else {
+		for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+			if (ifActiveBondtype[iBondtype])
+				CalcBondRange(iBondtype, 0, nBond[iBondtype]);
+		}
+	}
+
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		if (ifActiveBondtype[iBondtype])
+			ifSorted[iBondtype] = false;
+	}
+	ifContact.assign(ifContact.size(), false);
 
 #ifdef DEBUG_MOLECULE
 	debug << "bond:" << endl;
 	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
 		debug << num2bdtype[iBondtype] << " : ";
 		for (int iBond = 0; iBond < nBond[iBondtype]; ++iBond) {
-			debug << bond[iBondtype][iBond].len << ", ";
+			debug << (ifCompact[iBondtype] ? bondKey[iBondtype][iBond] : bond[iBondtype][iBond].len) << ", ";
 		}
 		debug << endl;
 	}
@@ -309,6 +627,308 @@ void Molecule::CalcBond()
 
 }
 
+void Molecule::DoSortBond(const int & iBondtype)
+{
+	if (ifCompact[iBondtype]) {
+		const size_t n = nBond[iBondtype];
+		SortBondWith(iBondtype, arena.Alloc<double>(n), arena.Alloc<int>(n));
+	}
+	else {
+		SortBondWith(iBondtype, nullptr, nullptr);
+	}
+	ifSorted[iBondtype] = true;
+}
+
+void Molecule::SortBondWith(const int & iBondtype, double * tmpKey, int * tmpIdx)
+{
+	if (ifCompact[iBondtype]) {
+		const size_t n = nBond[iBondtype];
+		if (nThread != 1 && n >= PARALLEL_SORT_MIN)
+			ParallelRadixSort(bondKey[iBondtype].data(), bondIdx[iBondtype].data(), n, tmpKey, tmpIdx, Pool());
+		else
+			RadixSort(bondKey[iBondtype].data(), bondIdx[iBondtype].data(), n, tmpKey, tmpIdx);
+	}
+	else {
+		// equal lengths in bondTravlist order, i.e. by (iAtom, jAtom): the order of a stable sort and of the
+		// compact path, without the buffer of std::stable_sort
+		std::sort(bond[iBondtype].begin(), bond[iBondtype].end(), [](const Bond & a, const Bond & b) {
+			return a.len < b.len || (a.len == b.len && (a.iAtom < b.iAtom || (a.iAtom == b.iAtom && a.jAtom < b.jAtom)));
+		});
+	}
+}
+
+void Molecule::SortAllBond()
+{
+	// ranks of a stream frame are sorted by CalcStream
+	if (ifStream)
+		return;
+
+	int nSort = 0;
+	long long nSortBond = 0;
+	int * sortList = arena.Alloc<int>(nBondtype);
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		if (ifActiveBondtype[iBondtype] && !ifSorted[iBondtype]) {
+			sortList[nSort++] = iBondtype;
+			nSortBond += nBond[iBondtype];
+		}
+	}
+
+	if (nThread == 1 || nSortBond < PARALLEL_MIN) {
+		for (int k = 0; k < nSort; ++k)
+			DoSortBond(sortList[k]);
+		return;
+	}
+
+	// scratch is taken before the tasks start, Arena is not thread-safe
+	double ** tmpKey = arena.Alloc<double *>(nSort);
+	int ** tmpIdx = arena.Alloc<int *>(nSort);
+	for (int k = 0; k < nSort; ++k) {
+		const size_t n = ifCompact[sortList[k]] ? nBond[sortList[k]] : 0;
+		tmpKey[k] = arena.Alloc<double>(n);
+		tmpIdx[k] = arena.Alloc<int>(n);
+	}
+
+	Pool().ParallelFor(nSort, [&](int k) {
+		SortBondWith(sortList[k], tmpKey[k], tmpIdx[k]);
+	});
+
+	for (int k = 0; k < nSort; ++k)
+		ifSorted[sortList[k]] = true;
+}
+
+void Molecule::RankedLens(const int & iBondtype, double * len)
+{
+	const int n = nBond[iBondtype];
+	Map<ArrayXd> out(len, n);
+	if (ifStream) {
+		const vector<Ranked> & lo = rankMin[iBondtype];
+		for (int iBond = 0; iBond < n; ++iBond)
+			len[iBond] = lo[iBond].len;
+	}
+	else {
+		SortBond(iBondtype);
+		if (ifCompact[iBondtype]) {
+			out = Map<const ArrayXd>(bondKey[iBondtype].data(), n);
+		}
+		else {
+			for (int iBond = 0; iBond < n; ++iBond)
+				len[iBond] = bond[iBondtype][iBond].len;
+		}
+	}
+
+	// square roots of the whole row at once, vectorized by Eigen
+	if (ifSquared)
+		out = out.sqrt();
+}
+
+void Molecule::BondLens(const int & iBondtype, double * len)
+{
+	const int n = nBond[iBondtype];
+	Map<ArrayXd> out(len, n);
+	if (ifStream) {
+		out = Map<const ArrayXd>(streamLens[iBondtype], n);
+	}
+	else if (ifCompact[iBondtype]) {
+		out = Map<const ArrayXd>(bondKey[iBondtype].data(), n);
+	}
+	else {
+		for (int iBond = 0; iBond < n; ++iBond)
+			len[iBond] = bond[iBondtype][iBond].len;
+	}
+
+	if (ifSquared)
+		out = out.sqrt();
+}
+
+void Molecule::CalcStream()
+{
+	// x, y, z of the atoms of each element, contiguous for the rows
+	double ** elemX = arena.Alloc<double *>(nElem);
+	for (int iE = 0; iE < nElem; ++iE) {
+		const int n = nAtom[iE];
+		elemX[iE] = arena.Alloc<double>(3 * static_cast<size_t>(n));
+		for (int k = 0; k < n; ++k) {
+			const int iAtom = atomTravlist[iE][k];
+			elemX[iE][k] = X(0, iAtom);
+			elemX[iE][n + k] = X(1, iAtom);
+			elemX[iE][2 * n + k] = X(2, iAtom);
+		}
+	}
+
+	for (const int & iContact : activeContact)
+		contact[iContact].clear();
+
+	for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+		if (!ifActiveBondtype[iBondtype])
+			continue;
+
+		// lengths kept for BondLens, each chunk writes those of its rows; taken here, Arena is not thread-safe
+		streamLens[iBondtype] = (iBondtype < static_cast<int>(keepLens.size()) && keepLens[iBondtype])
+			? arena.Alloc<double>(nBond[iBondtype]) : nullptr;
+
+		// chunks of a BondType have rows of their own, so they set bits of contact rows of their own
+		const int first = chunkFirst[iBondtype];
+		const int nChunk = chunkFirst[iBondtype + 1] - first;
+		if (ifParallel() && nChunk > 1) {
+			Pool().ParallelFor(nChunk, [&](int k) {
+				StreamChunk(iBondtype, first + k, elemX);
+			});
+		}
+		else {
+			for (int k = 0; k < nChunk; ++k)
+				StreamChunk(iBondtype, first + k, elemX);
+		}
+
+		// merge the heaps of the chunks
+		vector<Ranked> & lo = rankMin[iBondtype];
+		vector<Ranked> & hi = rankMax[iBondtype];
+		lo.clear();
+		hi.clear();
+		for (int c = first; c < first + nChunk; ++c) {
+			lo.insert(lo.end(), chunkMin[c].begin(), chunkMin[c].end());
+			hi.insert(hi.end(), chunkMax[c].begin(), chunkMax[c].end());
+		}
+
+		const size_t kMin = RankNum(rankMinNum, iBondtype);
+		if (lo.size() > kMin) {
+			std::nth_element(lo.begin(), lo.begin() + kMin, lo.end());
+			lo.resize(kMin);
+		}
+		std::sort(lo.begin(), lo.end());
+
+		const size_t kMax = RankNum(rankMaxNum, iBondtype);
+		if (hi.size() > kMax) {
+			std::nth_element(hi.begin(), hi.begin() + kMax, hi.end(), std::greater<Ranked>());
+			hi.resize(kMax);
+		}
+		std::sort(hi.begin(), hi.end(), std::greater<Ranked>());
+	}
+
+	for (const int & iContact : activeContact) {
+		contact[iContact].Symmetrize();
+		ifContact[iContact] = true;
+	}
+}
+
+void Molecule::StreamChunk(const int & iBondtype, const int & c, const double * const * elemX)
+{
+	const BondType & type = bondtype_list[iBondtype];
+	const bool same = (type.iElem == type.jElem);
+	const int nCol = nAtom[type.jElem];
+	const double * xi = elemX[type.iElem];
+	const double * xj = elemX[type.jElem];
+	const int nRowAtom = nAtom[type.iElem];
+	const vector<int> & iAtoms = atomTravlist[type.iElem];
+	const vector<int> & jAtoms = atomTravlist[type.jElem];
+
+	// heaps of the kMin shortest and kMax longest bonds; bonds come in order of index, so a bond
+	// as long as the top of a full heap is after it
+	const size_t kMin = RankNum(rankMinNum, iBondtype);
+	const size_t kMax = RankNum(rankMaxNum, iBondtype);
+	vector<Ranked> & lo = chunkMin[c];
+	vector<Ranked> & hi = chunkMax[c];
+	lo.clear();
+	hi.clear();
+	double loCut = (kMin > 0) ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+	double hiCut = (kMax > 0) ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+
+	const int nContact = static_cast<int>(activeContact.size());
+	double * keep = streamLens[iBondtype];
+	double len[TILE_ATOM];
+
+	for (int r = chunkBegin[c]; r < chunkEnd[c]; ++r) {
+		const int iAtom = iAtoms[r];
+		const double x = xi[r];
+		const double y = xi[nRowAtom + r];
+		const double z = xi[2 * nRowAtom + r];
+		const int jFirst = same ? r + 1 : 0;
+		const long long base = RowBase(same, nCol, r) - jFirst;
+
+		for (int j0 = jFirst; j0 < nCol; j0 += TILE_ATOM) {
+			const int n = std::min(TILE_ATOM, nCol - j0);
+			const double * jx = xj + j0;
+			const double * jy = xj + nCol + j0;
+			const double * jz = xj + 2 * nCol + j0;
+			for (int k = 0; k < n; ++k) {
+				const double dx = x - jx[k];
+				const double dy = y - jy[k];
+				const double dz = z - jz[k];
+				len[k] = dx * dx + dy * dy + dz * dz;
+			}
+			if (!ifSquared) {
+				for (int k = 0; k < n; ++k)
+					len[k] = std::sqrt(len[k]);
+			}
+			if (keep)
+				std::copy(len, len + n, keep + base + j0);
+
+			for (int k = 0; k < n; ++k) {
+				if (len[k] < loCut) {
+					const Ranked b = { len[k], static_cast<int>(base + j0 + k), iAtom, jAtoms[j0 + k] };
+					if (lo.size() == kMin) {
+						std::pop_heap(lo.begin(), lo.end());
+						lo.back() = b;
+					}
+					else {
+						lo.push_back(b);
+					}
+					std::push_heap(lo.begin(), lo.end());
+					if (lo.size() == kMin)
+						loCut = lo.front().len;
+				}
+				if (len[k] >= hiCut) {
+					const Ranked b = { len[k], static_cast<int>(base + j0 + k), iAtom, jAtoms[j0 + k] };
+					if (hi.size() == kMax) {
+						std::pop_heap(hi.begin(), hi.end(), std::greater<Ranked>());
+						hi.back() = b;
+					}
+					else {
+						hi.push_back(b);
+					}
+					std::push_heap(hi.begin(), hi.end(), std::greater<Ranked>());
+					if (hi.size() == kMax)
+						hiCut = hi.front().len;
+				}
+				for (int a = 0; a < nContact; ++a) {
+					const int iContact = activeContact[a];
+					if (ifWithin(len[k], contact_rcut[iContact]))
+						contact[iContact].setHalf(iAtom, jAtoms[j0 + k]);
+				}
+			}
+		}
+	}
+}
+
+const ContactMap & Molecule::refContactMap(const int & iContact)
+{
+	if (!ifContact[iContact]) {
+		ContactMap & cmap = contact[iContact];
+		const double rcut = contact_rcut[iContact];
+
+		cmap.clear();
+		for (int iBondtype = 0; iBondtype < nBondtype; ++iBondtype) {
+			if (!ifActiveBondtype[iBondtype])
+				continue;
+			if (ifCompact[iBondtype]) {
+				for (int iBond = 0; iBond < nBond[iBondtype]; ++iBond) {
+					if (ifWithin(bondKey[iBondtype][iBond], rcut)) {
+						const Array2 & ij = bondTravlist[iBondtype][bondIdx[iBondtype][iBond]];
+						cmap.set(ij.iAtom, ij.jAtom);
+					}
+				}
+			}
+			else {
+				for (const auto & b : bond[iBondtype]) {
+					if (ifWithin(b.len, rcut))
+						cmap.set(b.iAtom, b.jAtom);
+				}
+			}
+		}
+		ifContact[iContact] = true;
+	}
+	return contact[iContact];
+}
+
 void Molecule::CalcVectorR()
 {
 	int pos = 0;
@@ -360,9 +980,7 @@ int Molecule::Elem2Num(const std::string & elem)
 		return elem2num.at(elem);
 	}
 	catch (std::out_of_range & e) {
-		cerr << "Error: " << __FILE__ << ": " << __LINE__ << endl;
-		cerr << "Element: " << elem << " doesn't exist!" << endl;
-		exit(1);
+		throw std::invalid_argument("Element: " + elem + " doesn't exist!");
 	}
 }
 
@@ -385,12 +1003,18 @@ int Molecule::BondType2Num(const int & iE, const int & jE)
 		return bdtype2num.at(BondType(iE, jE));
 	}
 	catch (std::out_of_range & e) {
-		cerr << "Error: " << __FILE__ << ": " << __LINE__ << endl;
-		cerr << "The BondType: " << BondType(iE, jE) << " doesn't exist!" << endl;
-		exit(1);
+		std::ostringstream sout;
+		sout << "The BondType: " << BondType(iE, jE) << " doesn't exist!";
+		throw std::invalid_argument(sout.str());
 	}
 }
 
+int Molecule::FindBondType(const int & iE, const int & jE)
+{
+	const auto it = bdtype2num.find(BondType(iE, jE));
+	return (it == bdtype2num.end()) ? -1 : it->second;
+}
+
 Molecule::BondType Molecule::Num2BondType(const int & iBondtype)
 {
 	try {
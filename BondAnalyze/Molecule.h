@@ -6,10 +6,17 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Core>
+#include "ContactMap.h"
+#include "Arena.h"
 
 extern std::ofstream debug;
 
+class XyzReader;
+class ThreadPool;
+
 #define DEBUG_MOLECULE
 
 class Molecule
@@ -22,6 +29,7 @@ public:
 	class Bond;
 	class BondType;
 	struct Array2;
+	struct Schema;
 	typedef std::map<std::string, int> str2int;
 	typedef std::map<int, std::string> int2str;
 	typedef std::map<BondType, int> bdtype2int;
@@ -40,15 +48,46 @@ public:
 	inline static void usingMatrixR() { ifMatrixR = true; }
 	// use bond
 	inline static void usingBond() { ifBond = true; }
+	// store BondTypes of at least minBond bonds as length keys + pair indices, sorted by radix sort
+	inline static void usingCompact(const int & minBond) { compactMin = minBond; }
+	// use contact map of cutoff rcut, return its id; a Molecule builds only the maps given to UseContact()
+	static int usingContact(const double & rcut);
+	// number of contact map ids
+	static inline int ContactNum() { return static_cast<int>(contact_rcut.size()); }
+	// calculate and sort a big frame with n threads, 0 for one per cpu, 1 for serial
+	inline static void usingThreads(const int & n) { nThread = n; }
+	// pool of the threads of usingThreads(), for work on a frame outside Molecule too
+	static ThreadPool & Pool();
+	// calculate bonds tile by tile without storing them, keeping only the ranks of usingRank()
+	// and the contact maps; must be called before InputInfo()
+	inline static void usingStream() { ifStream = true; }
+	// keep squared lengths in the bond tables, rank and select on them, and take the square root
+	// only of the lengths returned by RankedLen / RankedLens / RankedBond
+	inline static void usingSquared() { ifSquared = true; }
+	// RankedLen / RankedBond of the num-th (from 0) shortest bond of iBondtype, or the num-th longest if sortGreat,
+	// will be asked for; needed by usingStream()
+	static void usingRank(const int & iBondtype, const int & num, const bool & sortGreat);
+	// BondLens of iBondtype will be asked for: a stream frame then keeps all its lengths as calculated, unranked
+	static void usingLens(const int & iBondtype);
 
 	// =============== input function ===============
 
 	// input static info
 	static void InputInfo(std::istream &);
+	// exchange the static info in use with s, to keep several molecules in one process
+	static void SwapSchema(Schema & s);
 	// input energy
 	inline bool InputEnergy(std::istream & fin) { return (fin >> Energy) ? true : false; }
 	// input X
 	void InputX(std::istream &);
+	// input energy from the comment line
+	bool InputEnergy(XyzReader &);
+	// input energy from a comment line read by XyzReader::ReadLine
+	bool InputEnergy(const char * comment);
+	// input X from atom lines
+	bool InputX(XyzReader &);
+	// input X from 3 * totAtom coordinates, x y z of each atom
+	void InputX(const double * x);
 	// input string data
 	friend std::istream & operator >> (std::istream &, Molecule &);
 
@@ -65,6 +104,31 @@ public:
 	inline double operator - (const Molecule & m) const { return (vectorR - m.vectorR).norm(); }
 	// calculate bond
 	void CalcBond();
+	// calculate only the BondTypes marked in needBondtype, and parse only the atoms of them and those marked in needAtom
+	void Project(const std::vector<bool> & needBondtype, const std::vector<bool> & needAtom = std::vector<bool>());
+	// allocate and build only the contact maps marked in needContact (ids of usingContact), none by default
+	void UseContact(const std::vector<bool> & needContact);
+
+	// =============== geometry cache ===============
+
+	// sort bonds of iBondtype by length, at most once per frame
+	inline void SortBond(const int & iBondtype) {
+		if (!ifSorted[iBondtype])
+			DoSortBond(iBondtype);
+	}
+	// sort all BondTypes in use, those not yet sorted in this frame, concurrently for a big frame
+	void SortAllBond();
+	// return length of the num-th (from 0) shortest bond of iBondtype, or the num-th longest if sortGreat
+	inline double RankedLen(const int & iBondtype, int num, const bool & sortGreat);
+	// store lengths of all bonds of iBondtype to len, shortest first
+	void RankedLens(const int & iBondtype, double * len);
+	// store lengths of all bonds of iBondtype to len in no particular order, without sorting them;
+	// a stream frame needs usingLens(iBondtype)
+	void BondLens(const int & iBondtype, double * len);
+	// return the num-th (from 0) shortest bond of iBondtype, or the num-th longest if sortGreat
+	inline Bond RankedBond(const int & iBondtype, int num, const bool & sortGreat);
+	// return contact map of iContact (from usingContact), built from bond at most once per frame
+	const ContactMap & refContactMap(const int & iContact);
 
 	// =============== data pointer ===============
 
@@ -85,11 +149,16 @@ public:
 	inline Eigen::VectorXd & refVectorR() { return vectorR; }
 	// return reference of matrixR
 	inline Eigen::MatrixXd & refMatrixR() { return matrixR; }
-	// return reference of bond
+	// return reference of bond, empty for compact BondTypes
 	inline std::vector<std::vector<Bond>> & refBond() { return bond; }
-	// convert BondType to iBondtype;
+	// return scratch memory of current frame, reset by InputX
+	inline Arena & refArena() { return arena; }
+	// convert BondType to iBondtype, throw std::invalid_argument if the BondType doesn't exist
 	static int BondType2Num(const int & iE, const int & jE);
+	// same as BondType2Num, but return -1 if the BondType doesn't exist
+	static int FindBondType(const int & iE, const int & jE);
 	static BondType Num2BondType(const int & iBondtype);
+	// throw std::invalid_argument if the element doesn't exist
 	static int Elem2Num(const std::string &);
 	static std::string Num2Elem(const int &);
 
@@ -136,8 +205,10 @@ private:
 public:
 	// number of bonds for each BondType
 	static std::vector<int> nBond;
-	// bond traversal list, a list of atom ids for each BondType, used to calculate bond data
+	// bond traversal list, a list of atom ids for each BondType, used to calculate bond data; empty with usingStream()
 	static std::vector<std::vector<Array2>> bondTravlist;
+	// whether a BondType is stored compact, see usingCompact()
+	static std::vector<bool> ifCompact;
 
 	// ===========================================================
 	// ========================= private =========================
@@ -150,11 +221,60 @@ private:
 	// lines of atoms
 	std::vector<std::string> atom_str;
 
+	// a bond of a stream frame, ordered by length then by index in the BondType,
+	// the same order as the stable sort of a compact BondType
+	struct Ranked
+	{
+		double len;
+		int iBond;
+		int iAtom;
+		int jAtom;
+
+		friend inline bool operator < (const Ranked & a, const Ranked & b) {
+			return a.len < b.len || (a.len == b.len && a.iBond < b.iBond);
+		}
+		friend inline bool operator > (const Ranked & a, const Ranked & b) { return b < a; }
+	};
+
 	// =============== molcule data ===============
 	double Energy;
 	Eigen::MatrixXd X;
 	Eigen::VectorXd vectorR;
 	std::vector<std::vector<Bond>> bond;
+	// compact BondTypes: bond lengths, and indices of bondTravlist[iBondtype] permuted with them
+	std::vector<std::vector<double>> bondKey;
+	std::vector<std::vector<int>> bondIdx;
+	// whether bond of iBondtype has been sorted in current frame
+	std::vector<bool> ifSorted;
+	// contact maps, one for each cutoff in contact_rcut
+	std::vector<ContactMap> contact;
+	// whether contact[iContact] has been built in current frame
+	std::vector<bool> ifContact;
+	// ids of the contact maps in use, see UseContact()
+	std::vector<int> activeContact;
+	// per-frame scratch
+	Arena arena;
+	// whether a BondType is calculated, all by default, see Project()
+	std::vector<bool> ifActiveBondtype;
+	// whether an atom is parsed, all by default, see Project()
+	std::vector<bool> ifActiveAtom;
+	// number of bonds of the active BondTypes
+	long long nActiveBond;
+	// tiles of CalcBond: BondType and first bond of each
+	std::vector<int> tileBondtype;
+	std::vector<int> tileBegin;
+	// stream frame: chunks of rows of each BondType, rows [chunkBegin[c], chunkEnd[c]) of chunk c;
+	// chunks of iBondtype are [chunkFirst[iBondtype], chunkFirst[iBondtype + 1])
+	std::vector<int> chunkFirst;
+	std::vector<int> chunkBegin;
+	std::vector<int> chunkEnd;
+	// stream frame: the shortest / longest bonds of each chunk as heaps, then of each BondType, sorted
+	std::vector<std::vector<Ranked>> chunkMin;
+	std::vector<std::vector<Ranked>> chunkMax;
+	std::vector<std::vector<Ranked>> rankMin;
+	std::vector<std::vector<Ranked>> rankMax;
+	// stream frame: lengths of each BondType of usingLens() in bond order, in arena, nullptr for the others
+	std::vector<double *> streamLens;
 
 	Eigen::MatrixXd matrixR;
 	//Eigen::MatrixXd matrixR2;
@@ -165,7 +285,46 @@ private:
 	static bool ifVectorR;
 	static bool ifMatrixR;
 	static bool ifBond;
+	// cutoffs of contact maps
+	static std::vector<double> contact_rcut;
+	// minimum number of bonds of a compact BondType
+	static int compactMin;
+	// threads of a big frame, see usingThreads()
+	static int nThread;
+	static bool ifStream;
+	static bool ifSquared;
+	// whether a bond of the length stored in the bond tables is shorter than rcut
+	static inline bool ifWithin(const double & len, const double & rcut) {
+		if (!ifSquared)
+			return len < rcut;
+		// len * (1 +- 1e-12) brackets the rounding of rcut * rcut, the square root decides between
+		const double r2 = rcut * rcut;
+		return len < r2 * (1.0 - 1e-12) || (len < r2 * (1.0 + 1e-12) && std::sqrt(len) < rcut);
+	}
+	// number of shortest / longest bonds of each BondType kept by a stream frame, see usingRank()
+	static std::vector<int> rankMinNum;
+	static std::vector<int> rankMaxNum;
+	// BondTypes whose lengths a stream frame keeps, see usingLens()
+	static std::vector<bool> keepLens;
+	static inline int RankNum(const std::vector<int> & num, const int & iBondtype) {
+		return (iBondtype < static_cast<int>(num.size())) ? std::min(num[iBondtype], nBond[iBondtype]) : 0;
+	}
 	static void BondInfo();
+	// whether the frame is big enough to calculate in parallel
+	inline bool ifParallel() const;
+	void DoSortBond(const int & iBondtype);
+	// sort with the given scratch of nBond[iBondtype] elements, ifSorted not set
+	void SortBondWith(const int & iBondtype, double * tmpKey, int * tmpIdx);
+	// calculate bonds [begin, end) of iBondtype
+	void CalcBondRange(const int & iBondtype, const int & begin, const int & end);
+	// split the active BondTypes into tiles of CalcBond
+	void BuildTile();
+	// calculate the data in use after X is input
+	void CalcFrame();
+	// calculate bonds of a stream frame
+	void CalcStream();
+	// stream the rows of chunk c of iBondtype, elemX holds x, y, z of the atoms of each element
+	void StreamChunk(const int & iBondtype, const int & c, const double * const * elemX);
 };
 
 // ========== template functions ==========
@@ -230,6 +389,30 @@ struct Molecule::Array2
 	Array2(const int & i, const int & j) :iAtom(i), jAtom(j) {}
 };
 
+// static info of a molecule, see SwapSchema()
+struct Molecule::Schema
+{
+	std::string name;
+	int nElem;
+	std::vector<std::string> elem_list;
+	str2int elem2num;
+	int2str num2elem;
+	int totAtom;
+	std::vector<int> nAtom;
+	std::vector<int> atom_list;
+	std::vector<std::vector<int>> atomTravlist;
+	int totBond;
+	int nBondtype;
+	std::vector<BondType> bondtype_list;
+	bdtype2int bdtype2num;
+	int2bdtype num2bdtype;
+	std::vector<int> nBond;
+	std::vector<std::vector<Array2>> bondTravlist;
+	std::vector<bool> ifCompact;
+
+	Schema() :nElem(0), totAtom(0), totBond(0), nBondtype(0) {}
+};
+
 
 // ============================================================
 // ========================= Bond =============================
@@ -252,13 +435,13 @@ public:
 		jAtom = j;
 	}
 
-	inline double getLen() { return len; }
+	inline double getLen() const { return len; }
 
-	inline int getAtom(const int & elem) {
+	inline int getAtom(const int & elem) const {
 		return ((elem == iElem) ? iAtom : jAtom);
 	}
 
-	inline int getOtherAtom(const int & elem) {
+	inline int getOtherAtom(const int & elem) const {
 		return ((elem == iElem) ? jAtom : iAtom);
 	}
 
@@ -282,4 +465,47 @@ private:
 };
 // ============================================================
 
+// ========== inline functions ==========
+
+inline double Molecule::RankedLen(const int & iBondtype, int num, const bool & sortGreat)
+{
+	double len;
+	if (ifStream) {
+		len = (sortGreat ? rankMax : rankMin)[iBondtype][num].len;
+	}
+	else {
+		SortBond(iBondtype);
+		if (sortGreat)
+			num = nBond[iBondtype] - 1 - num;
+		len = ifCompact[iBondtype] ? bondKey[iBondtype][num] : bond[iBondtype][num].len;
+	}
+	return ifSquared ? std::sqrt(len) : len;
+}
+
+inline Molecule::Bond Molecule::RankedBond(const int & iBondtype, int num, const bool & sortGreat)
+{
+	Bond b;
+	if (ifStream) {
+		const Ranked & r = (sortGreat ? rankMax : rankMin)[iBondtype][num];
+		b = Bond(r.len, r.iAtom, r.jAtom);
+	}
+	else {
+		SortBond(iBondtype);
+		if (sortGreat)
+			num = nBond[iBondtype] - 1 - num;
+		if (ifCompact[iBondtype]) {
+			const Array2 & ij = bondTravlist[iBondtype][bondIdx[iBondtype][num]];
+			b = Bond(bondKey[iBondtype][num], ij.iAtom, ij.jAtom);
+		}
+		else {
+			b = bond[iBondtype][num];
+		}
+	}
+	if (ifSquared)
+		b.len = std::sqrt(b.len);
+	return b;
+}
+
+// ========================================
+
 #endif // !MOLECULE_H_
\ No newline at end of file
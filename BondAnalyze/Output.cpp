@@ -0,0 +1,499 @@
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <cstdlib>
+#include "Output.h"
+#include "ThreadPool.h"
+
+using std::string;
+using std::vector;
+using std::istringstream;
+
+// a BondType of at least SKETCH_PARALLEL_MIN bonds is sketched by parts in parallel
+constexpr int SKETCH_PARALLEL_MIN = 1 << 16;
+
+Output::Output()
+	:mode(DUMP), rule_file(), rule_line(), file("-"), format(TextOutput::TEXT), ifPacked(false), tol(1e-4), ifShm(false), nSlot(4096),
+	ifHeader(true), ifEnergy(true),
+	segLen(4096), dt(1.0), analyzer(), fout(), text(), packed(), shm(), row(), nFrame(0), mean(), m2(), vmin(), vmax(),
+	quantile({ 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 }), sketchK(200), ifColSketch(true), ifTypeSketch(true),
+	colSketch(), sketchType(), typeSketch(), lens(), series(),
+	defForm(std::numeric_limits<double>::quiet_NaN()), defBreak(std::numeric_limits<double>::quiet_NaN()),
+	formCut(), breakCut(), state()
+{
+}
+
+bool Output::Parse(const string & spec, string & error)
+{
+	int header = -1;
+	int energy = -1;
+
+	istringstream sin(spec);
+	string item;
+	while (getline(sin, item, ',')) {
+		const auto pos = item.find('=');
+		if (pos == string::npos) {
+			error = "output option without value: " + item;
+			return false;
+		}
+		const string key = item.substr(0, pos);
+		const string value = item.substr(pos + 1);
+
+		if (key == "mode") {
+			if (value == "dump")
+				mode = DUMP;
+			else if (value == "rules")
+				mode = RULES;
+			else if (value == "rule")
+				mode = RULE;
+			else if (value == "energy")
+				mode = ENERGY;
+			else if (value == "stats")
+				mode = STATS;
+			else if (value == "quantile")
+				mode = QUANTILE;
+			else if (value == "acf")
+				mode = ACF;
+			else if (value == "spectrum")
+				mode = SPECTRUM;
+			else if (value == "events")
+				mode = EVENTS;
+			else {
+				error = "unknown output mode: " + value;
+				return false;
+			}
+		}
+		else if (key == "rules")
+			rule_file = value;
+		else if (key == "rule")
+			rule_line = value;
+		else if (key == "file")
+			file = value;
+		else if (key == "format") {
+			if (value == "text")
+				format = TextOutput::TEXT;
+			else if (value == "csv")
+				format = TextOutput::CSV;
+			else if (value == "packed")
+				ifPacked = true;
+			else if (value == "shm")
+				ifShm = true;
+			else {
+				error = "unknown output format: " + value;
+				return false;
+			}
+		}
+		else if (key == "segment")
+			segLen = atoi(value.c_str());
+		else if (key == "tol")
+			tol = atof(value.c_str());
+		else if (key == "slots")
+			nSlot = atoll(value.c_str());
+		else if (key == "dt")
+			dt = atof(value.c_str());
+		else if (key == "form")
+			defForm = atof(value.c_str());
+		else if (key == "break")
+			defBreak = atof(value.c_str());
+		else if (key == "q") {
+			quantile.clear();
+			istringstream qin(value);
+			string q;
+			while (getline(qin, q, ':')) {
+				char * stop;
+				const double v = strtod(q.c_str(), &stop);
+				if (q.empty() || *stop != '\0' || !(v >= 0.0 && v <= 1.0)) {
+					error = "invalid quantile: " + q;
+					return false;
+				}
+				quantile.push_back(v);
+			}
+		}
+		else if (key == "k")
+			sketchK = atoi(value.c_str());
+		else if (key == "sketch") {
+			if (value == "all" || value == "columns" || value == "bondtypes") {
+				ifColSketch = (value != "bondtypes");
+				ifTypeSketch = (value != "columns");
+			}
+			else {
+				error = "unknown output sketch: " + value;
+				return false;
+			}
+		}
+		else if (key == "header")
+			header = (value != "0");
+		else if (key == "energy")
+			energy = (value != "0");
+		else {
+			error = "unknown output option: " + key;
+			return false;
+		}
+	}
+
+	if (ifPacked && ((mode != DUMP && mode != RULES && mode != RULE) || !(tol > 0))) {
+		error = "format packed needs mode dump / rules / rule and tol > 0";
+		return false;
+	}
+	if (ifShm && ((mode != DUMP && mode != RULES && mode != RULE) || file == "-" || nSlot < 1)) {
+		error = "format shm needs mode dump / rules / rule, file=/NAME and slots > 0";
+		return false;
+	}
+
+	if (mode == QUANTILE && (quantile.empty() || sketchK < 8)) {
+		error = "mode quantile needs quantiles in q and k >= 8";
+		return false;
+	}
+
+	ifHeader = (header < 0) ? (mode != RULE) : (header != 0);
+	ifEnergy = (energy < 0) ? (mode != RULE) : (energy != 0);
+
+	if (mode == RULE) {
+		if (!analyzer.AddRule(rule_line)) {
+			error = "invalid rule: " + rule_line + " (" + analyzer.RuleError() + ")";
+			return false;
+		}
+	}
+	else if (mode == RULES || mode == EVENTS || (mode != DUMP && mode != ENERGY && !rule_file.empty())) {
+		std::ifstream fin(rule_file.c_str(), std::ifstream::in);
+		if (!fin) {
+			error = "rule file " + rule_file + " open failed";
+			return false;
+		}
+
+		if (mode == EVENTS)
+			return ReadEventRules(fin, error);
+
+		string line;
+		if (!analyzer.AddRules(fin, &line)) {
+			error = "invalid rule: " + line + " (" + analyzer.RuleError() + ")";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Output::ReadEventRules(std::istream & fin, string & error)
+{
+	string line;
+	while (getline(fin, line)) {
+		if (line.empty() || line[0] == '#' || line[0] == ' ' || line[0] == '\r')
+			continue;
+
+		// rules start with a letter, thresholds with a number, which may be signed
+		double form = defForm;
+		double brk = defBreak;
+		string rule_text = line;
+		const char * b = line.c_str();
+		char * stop;
+		const double value = strtod(b, &stop);
+		if (stop != b) {
+			form = value;
+			b = stop;
+			brk = strtod(b, &stop);
+			if (stop == b) {
+				error = "invalid thresholds: " + line;
+				return false;
+			}
+			rule_text = stop;
+			rule_text.erase(0, rule_text.find_first_not_of(" \t"));
+		}
+
+		if (std::isnan(form) || std::isnan(brk) || form > brk) {
+			error = "no thresholds form <= break of rule: " + line;
+			return false;
+		}
+		if (!analyzer.AddRule(rule_text)) {
+			error = "invalid rule: " + line + " (" + analyzer.RuleError() + ")";
+			return false;
+		}
+		formCut.push_back(form);
+		breakCut.push_back(brk);
+	}
+
+	state.assign(formCut.size(), -1);
+	return true;
+}
+
+bool Output::Open(string & error)
+{
+	// the ring is created once the columns are known, in Compile()
+	if (ifShm)
+		return true;
+
+	if (file != "-") {
+		fout.open(file.c_str(), std::ofstream::out | (ifPacked ? std::ofstream::binary : std::ofstream::openmode()));
+		if (!fout) {
+			error = "output file " + file + " open failed";
+			return false;
+		}
+	}
+
+	std::ostream & os = (file == "-") ? std::cout : fout;
+	// the tables written at the end have no energy column
+	text.reset(new TextOutput(os, ifHeader, ifEnergy && mode != STATS && mode != QUANTILE && mode != ACF && mode != SPECTRUM && mode != EVENTS, format));
+	return true;
+}
+
+void Output::Require(vector<bool> & needBondtype) const
+{
+	if (mode == ENERGY)
+		return;
+
+	vector<bool> need(needBondtype.size(), false);
+	analyzer.Require(need);
+	for (size_t i = 0; i < need.size(); ++i) {
+		if (need[i])
+			needBondtype[i] = true;
+	}
+	// the sketches keep the BondTypes of the rules at Compile, even those the rules drop later
+	for (const int & iBondtype : sketchType)
+		needBondtype[iBondtype] = true;
+}
+
+void Output::RequireContact(vector<bool> & needContact) const
+{
+	if (mode != ENERGY)
+		analyzer.RequireContact(needContact);
+}
+
+void Output::RequireAtom(vector<bool> & needAtom) const
+{
+	if (mode != ENERGY)
+		analyzer.RequireAtom(needAtom);
+}
+
+void Output::Compile(const std::shared_ptr<Molecule> & shared)
+{
+	analyzer.Compile(shared);
+
+	if (mode == ENERGY) {
+		text->WriteHeader(ifEnergy ? vector<string>{ "Energy" } : vector<string>());
+		return;
+	}
+
+	const int nCol = analyzer.ColNum();
+	row.resize(nCol);
+
+	if (mode == STATS) {
+		mean.assign(nCol, 0.0);
+		m2.assign(nCol, 0.0);
+		vmin.assign(nCol, std::numeric_limits<double>::infinity());
+		vmax.assign(nCol, -std::numeric_limits<double>::infinity());
+		text->WriteHeader({ "column", "n", "mean", "std", "min", "max" });
+	}
+	else if (mode == QUANTILE) {
+		if (ifColSketch) {
+			for (int i = 0; i < nCol; ++i)
+				colSketch.emplace_back(sketchK, i + 1);
+		}
+		if (ifTypeSketch) {
+			// all BondTypes for the full dump, else those of the rules, whose lengths a stream frame must then keep
+			vector<bool> need(Molecule::nBondtype, false);
+			analyzer.Require(need);
+			for (int iBondtype = 0; iBondtype < Molecule::nBondtype; ++iBondtype) {
+				if (!need[iBondtype] || Molecule::nBond[iBondtype] == 0)
+					continue;
+				sketchType.push_back(iBondtype);
+				typeSketch.emplace_back(1, Sketch(sketchK, (nCol + iBondtype + 1) << 8));
+				if (analyzer.ifRule())
+					Molecule::usingLens(iBondtype);
+			}
+		}
+
+		vector<string> name{ "column", "n" };
+		for (const double & q : quantile) {
+			std::ostringstream sout;
+			sout << 'q' << q;
+			name.push_back(sout.str());
+		}
+		name.push_back("rank_err");
+		text->WriteHeader(name);
+	}
+	else if (mode == EVENTS) {
+		text->WriteHeader({ "frame", "rule", "old", "new", "value" });
+	}
+	else if (mode == ACF || mode == SPECTRUM) {
+		series.reset(new Series(mode == ACF ? Series::ACF : Series::SPECTRUM, nCol, segLen, dt));
+
+		vector<string> name(1, mode == ACF ? "lag" : "frequency");
+		for (int i = 0; i < nCol; ++i)
+			name.push_back(analyzer.ColName(i));
+		text->WriteHeader(name);
+	}
+	else if (ifShm) {
+		vector<string> name;
+		for (int i = 0; i < nCol; ++i)
+			name.push_back(analyzer.ColName(i));
+		string error;
+		shm.reset(new ShmRing());
+		if (!shm->Create(file, name, nSlot, error)) {
+			std::cerr << "Error: " << __FILE__ << " : " << __LINE__ << std::endl;
+			std::cerr << error << std::endl;
+			exit(1);
+		}
+	}
+	else if (ifPacked) {
+		vector<string> name;
+		for (int i = 0; i < nCol; ++i)
+			name.push_back(analyzer.ColName(i));
+		packed.reset(new PackedWriter(fout.is_open() ? fout : std::cout, name, ifEnergy, tol));
+	}
+	else {
+		text->WriteHeader(analyzer);
+	}
+}
+
+void Output::Write(const long long & frame)
+{
+	if (mode == ENERGY) {
+		text->WriteRow(nullptr, 0, analyzer.Energy());
+		return;
+	}
+
+	analyzer.Analyze(row.data());
+
+	if (mode == STATS) {
+		// Welford's running mean and variance
+		nFrame++;
+		for (size_t i = 0; i < row.size(); ++i) {
+			const double delta = row[i] - mean[i];
+			mean[i] += delta / nFrame;
+			m2[i] += delta * (row[i] - mean[i]);
+			vmin[i] = std::min(vmin[i], row[i]);
+			vmax[i] = std::max(vmax[i], row[i]);
+		}
+	}
+	else if (mode == QUANTILE) {
+		for (size_t i = 0; i < colSketch.size(); ++i)
+			colSketch[i].Add(row[i]);
+		AddTypeSketch();
+	}
+	else if (series) {
+		series->Add(row.data());
+	}
+	else if (mode == EVENTS) {
+		static const char * const STATE_NAME[] = { "none", "broken", "formed" };
+		for (size_t i = 0; i < row.size(); ++i) {
+			int now = state[i];
+			if (row[i] < formCut[i])
+				now = 1;
+			else if (row[i] > breakCut[i])
+				now = 0;
+			else if (now < 0)
+				// first frame between thresholds: the nearer one
+				now = (row[i] - formCut[i] < breakCut[i] - row[i]) ? 1 : 0;
+
+			if (now != state[i]) {
+				text->WriteRow({ std::to_string(frame), analyzer.ColName(static_cast<int>(i)),
+					STATE_NAME[state[i] + 1], STATE_NAME[now + 1] }, &row[i], 1);
+				state[i] = now;
+			}
+		}
+	}
+	else if (shm) {
+		shm->WriteRow(frame, row.data(), analyzer.Energy());
+	}
+	else if (packed) {
+		packed->WriteRow(row.data(), analyzer.Energy());
+	}
+	else {
+		text->WriteRow(row.data(), analyzer.ColNum(), analyzer.Energy());
+	}
+}
+
+void Output::AddTypeSketch()
+{
+	Molecule & molc = analyzer.refMolecule();
+	// lengths of the full dump are in the row already
+	const double * len = row.data();
+	for (size_t t = 0; t < sketchType.size(); ++t) {
+		const int iBondtype = sketchType[t];
+		const int n = Molecule::nBond[iBondtype];
+		if (analyzer.ifRule()) {
+			lens.resize(n);
+			molc.BondLens(iBondtype, lens.data());
+			len = lens.data();
+		}
+
+		vector<Sketch> & part = typeSketch[t];
+		if (n < SKETCH_PARALLEL_MIN) {
+			part[0].Add(len, n);
+		}
+		else {
+			// a part of the lengths for each thread, each part always into the same sketch
+			if (part.size() == 1) {
+				for (int i = 1; i < Molecule::Pool().ThreadNum(); ++i)
+					part.emplace_back(sketchK, ((analyzer.ColNum() + iBondtype + 1) << 8) + i);
+			}
+			const int nPart = static_cast<int>(part.size());
+			Molecule::Pool().ParallelFor(nPart, [&](int i) {
+				const int begin = static_cast<int>(static_cast<long long>(n) * i / nPart);
+				const int end = static_cast<int>(static_cast<long long>(n) * (i + 1) / nPart);
+				part[i].Add(len + begin, end - begin);
+			});
+		}
+
+		if (!analyzer.ifRule())
+			len += n;
+	}
+}
+
+void Output::Close()
+{
+	if (mode == STATS) {
+		for (int i = 0; i < analyzer.ColNum(); ++i) {
+			const double value[5] = {
+				static_cast<double>(nFrame),
+				mean[i],
+				(nFrame > 1) ? std::sqrt(m2[i] / (nFrame - 1)) : 0.0,
+				vmin[i],
+				vmax[i]
+			};
+			text->WriteRow({ analyzer.ColName(i) }, value, 5);
+		}
+	}
+	else if (mode == QUANTILE) {
+		vector<double> value(quantile.size() + 1);
+		auto write = [&](const string & name, const Sketch & s) {
+			for (size_t j = 0; j < quantile.size(); ++j)
+				value[j] = s.Quantile(quantile[j]);
+			value.back() = s.RankError();
+			text->WriteRow({ name, std::to_string(s.Count()) }, value.data(), static_cast<int>(value.size()));
+		};
+
+		for (size_t i = 0; i < colSketch.size(); ++i)
+			write(analyzer.ColName(static_cast<int>(i)), colSketch[i]);
+		for (size_t t = 0; t < sketchType.size(); ++t) {
+			for (size_t part = 1; part < typeSketch[t].size(); ++part)
+				typeSketch[t][0].Merge(typeSketch[t][part]);
+			std::ostringstream sout;
+			sout << Molecule::bondtype_list[sketchType[t]];
+			write(sout.str(), typeSketch[t][0]);
+		}
+	}
+	else if (series) {
+		series->Finish();
+
+		// abscissa, then a value of each column
+		vector<double> line(analyzer.ColNum() + 1);
+		for (int i = 0; i < series->RowNum(); ++i) {
+			line[0] = series->Abscissa(i);
+			for (int col = 0; col < analyzer.ColNum(); ++col)
+				line[col + 1] = series->Value(i, col);
+			text->WriteRow(line.data(), static_cast<int>(line.size()), 0.0);
+		}
+	}
+
+	else if (packed) {
+		packed->Flush();
+	}
+	else if (shm) {
+		shm->Close();
+	}
+
+	if (fout.is_open())
+		fout.close();
+	else
+		std::cout.flush();
+}
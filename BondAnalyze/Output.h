@@ -0,0 +1,122 @@
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include "Analyzer.h"
+#include "TextOutput.h"
+#include "Series.h"
+#include "Packed.h"
+#include "ShmRing.h"
+#include "Sketch.h"
+
+// one output of a fan-out run (see Fanout), given as "key=value,key=value,..."
+//   mode=dump|rules|rule|energy|stats|quantile|acf|spectrum|events    what to write, default dump
+//   rules=FILE     rule file of mode rules / events, or of mode stats / quantile / acf / spectrum (all bonds without it)
+//   rule=LINE      the rule of mode rule
+//   file=PATH      destination, default "-" for stdout
+//   format=text|csv|packed|shm    packed: see Packed.h, shm: binary rows in shared memory object file,
+//                  see ShmRing.h; both for mode dump / rules / rule
+//   tol=X          tolerance of format packed, default 1e-4
+//   slots=N        rows of the ring of format shm, default 4096
+//   header=0|1, energy=0|1    default as on command line: on, but off for mode rule
+//   segment=N      frames of a segment of mode acf / spectrum, default 4096
+//   dt=T           time between frames, for the lag / frequency of mode acf / spectrum, default 1
+//   form=R, break=R    default thresholds of mode events
+//   q=Q:Q:...      quantiles of mode quantile, default 0.01:0.05:0.25:0.5:0.75:0.95:0.99
+//   k=N            size of the sketches of mode quantile, default 200, see Sketch
+//   sketch=all|columns|bondtypes    what mode quantile sketches, default all
+// mode stats writes count, mean, standard deviation, min and max of each column at the end
+// mode quantile writes count, quantiles and rank error bound of each column, and of all lengths of each BondType
+//   (those the rules need), from a sketch of each in constant memory; the lengths of a big frame are split among
+//   the threads of Molecule::Pool(), each part into a sketch of its own, merged at the end
+// mode acf / spectrum writes the autocovariance / power spectrum of each column at the end, see Series
+// mode events writes only the frames where a rule changes state, as "frame rule old new value":
+//   a rule is "formed" once its value drops below form and "broken" once it rises above break (form <= break),
+//   in between it keeps its state; the first frame writes the initial state of each rule with old "none";
+//   a rule line of mode events may start with its own thresholds, signed numbers: "form break rule..."
+class Output
+{
+public:
+	enum Mode { DUMP, RULES, RULE, ENERGY, STATS, QUANTILE, ACF, SPECTRUM, EVENTS };
+
+	Output();
+
+	// parse spec and compile its rules, return false and set error if invalid
+	bool Parse(const std::string & spec, std::string & error);
+	// open destination, return false and set error if failed
+	bool Open(std::string & error);
+
+	// mark the BondTypes this output needs
+	void Require(std::vector<bool> & needBondtype) const;
+	// mark the contact maps this output needs
+	void RequireContact(std::vector<bool> & needContact) const;
+	// mark the atoms this output reads besides those of its BondTypes
+	void RequireAtom(std::vector<bool> & needAtom) const;
+	// whether the last Write changed what this output needs, see Analyzer::ifReproject()
+	inline bool ifReproject() const { return mode != ENERGY && analyzer.ifReproject(); }
+	// finish rules on the shared Molecule and write header
+	void Compile(const std::shared_ptr<Molecule> & shared);
+	// write the current frame of the shared Molecule, frame is its index in input
+	void Write(const long long & frame);
+	// write stats and close destination
+	void Close();
+
+private:
+	Mode mode;
+	std::string rule_file;
+	std::string rule_line;
+	std::string file;
+	TextOutput::Format format;
+	bool ifPacked;
+	double tol;
+	bool ifShm;
+	long long nSlot;
+	bool ifHeader;
+	bool ifEnergy;
+	int segLen;
+	double dt;
+
+	Analyzer analyzer;
+	std::ofstream fout;
+	std::unique_ptr<TextOutput> text;
+	std::unique_ptr<PackedWriter> packed;
+	std::unique_ptr<ShmRing> shm;
+	std::vector<double> row;
+
+	// stats of each column
+	long long nFrame;
+	std::vector<double> mean;
+	std::vector<double> m2;
+	std::vector<double> vmin;
+	std::vector<double> vmax;
+
+	// sketches of mode quantile: of each column, and of each BondType of sketchType, one per part of a big frame
+	std::vector<double> quantile;
+	int sketchK;
+	bool ifColSketch;
+	bool ifTypeSketch;
+	std::vector<Sketch> colSketch;
+	std::vector<int> sketchType;
+	std::vector<std::vector<Sketch>> typeSketch;
+	std::vector<double> lens;
+
+	// time series of mode acf / spectrum
+	std::unique_ptr<Series> series;
+
+	// thresholds and state of each rule of mode events: -1 none, 0 broken, 1 formed
+	double defForm;
+	double defBreak;
+	std::vector<double> formCut;
+	std::vector<double> breakCut;
+	std::vector<int> state;
+
+	// read the rules of mode events with their thresholds
+	bool ReadEventRules(std::istream & fin, std::string & error);
+	// add the lengths of the BondTypes of sketchType in the current frame to their sketches
+	void AddTypeSketch();
+};
+
+#endif // !OUTPUT_H_
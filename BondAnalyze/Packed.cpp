@@ -0,0 +1,337 @@
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include "Packed.h"
+
+using std::vector;
+using std::istringstream;
+
+constexpr int FIXED = 0;
+constexpr int RICE = 1;
+
+static inline uint64_t ZigZag(const int64_t & d)
+{
+	return (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63);
+}
+
+static inline int64_t UnZigZag(const uint64_t & u)
+{
+	return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+}
+
+// number of bits of u, 0 for 0
+static inline int BitWidth(uint64_t u)
+{
+	int b = 0;
+	while (u) {
+		u >>= 1;
+		b++;
+	}
+	return b;
+}
+
+// bit stream, LSB first
+class BitWriter
+{
+	vector<uint8_t> & bytes;
+	uint64_t acc;
+	int nAcc;
+
+public:
+	explicit BitWriter(vector<uint8_t> & _bytes) :bytes(_bytes), acc(0), nAcc(0) {}
+
+	// write the low n bits of v, n <= 64
+	void Put(uint64_t v, int n) {
+		while (n > 0) {
+			const int k = (n < 32) ? n : 32;
+			const uint64_t part = v & ((1ULL << k) - 1);
+			acc |= part << nAcc;
+			nAcc += k;
+			v = (k < 64) ? v >> k : 0;
+			n -= k;
+			while (nAcc >= 8) {
+				bytes.push_back(static_cast<uint8_t>(acc));
+				acc >>= 8;
+				nAcc -= 8;
+			}
+		}
+	}
+
+	void Flush() {
+		if (nAcc > 0)
+			bytes.push_back(static_cast<uint8_t>(acc));
+		acc = 0;
+		nAcc = 0;
+	}
+};
+
+class BitReader
+{
+	const uint8_t * p;
+	const uint8_t * end;
+	uint64_t acc;
+	int nAcc;
+
+public:
+	BitReader(const uint8_t * _p, const uint8_t * _end) :p(_p), end(_end), acc(0), nAcc(0) {}
+
+	// read n bits, n <= 64; bits past the end read as 0
+	uint64_t Get(int n) {
+		uint64_t v = 0;
+		int shift = 0;
+		while (n > 0) {
+			const int k = (n < 32) ? n : 32;
+			while (nAcc < k) {
+				acc |= static_cast<uint64_t>(p < end ? *p++ : 0) << nAcc;
+				nAcc += 8;
+			}
+			v |= (acc & ((1ULL << k) - 1)) << shift;
+			acc >>= k;
+			nAcc -= k;
+			shift += k;
+			n -= k;
+		}
+		return v;
+	}
+
+	inline bool ifEnd() const { return p >= end && nAcc == 0; }
+};
+
+static void PutUint32(std::ostream & os, const uint32_t & v)
+{
+	const char b[4] = { static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24) };
+	os.write(b, 4);
+}
+
+static bool GetUint32(std::istream & is, uint32_t & v)
+{
+	unsigned char b[4];
+	if (!is.read(reinterpret_cast<char *>(b), 4))
+		return false;
+	v = b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+	return true;
+}
+
+// ======================================================
+// ======================= writer =======================
+// ======================================================
+
+PackedWriter::PackedWriter(std::ostream & _os, const vector<string> & name, const bool & _ifEnergy,
+	const double & _tol, const int & _blockRow, const bool & _ifRice)
+	:os(_os), nCol(static_cast<int>(name.size()) + (_ifEnergy ? 1 : 0)), tol(_tol), ifEnergy(_ifEnergy),
+	blockRow(_blockRow < 1 ? 1 : _blockRow), ifRice(_ifRice), q(), last(), nRow(0), bytes()
+{
+	q.resize(static_cast<size_t>(nCol) * blockRow);
+	last.assign(nCol, 0);
+
+	os << "BondAnalyze-packed 1\n";
+	os << "columns " << nCol << '\n';
+	os.precision(17);
+	os << "tolerance " << tol << '\n';
+	os << "energy " << (ifEnergy ? 1 : 0) << '\n';
+	os << "names";
+	for (const auto & s : name)
+		os << ' ' << s;
+	if (ifEnergy)
+		os << " Energy";
+	os << "\ndata\n";
+}
+
+void PackedWriter::WriteRow(const double * row, const double & energy)
+{
+	// the energy is the column after the values
+	const int nValue = ifEnergy ? nCol - 1 : nCol;
+	for (int col = 0; col < nValue; ++col)
+		q[static_cast<size_t>(col) * blockRow + nRow] = std::llround(row[col] / tol);
+	if (ifEnergy)
+		q[static_cast<size_t>(nValue) * blockRow + nRow] = std::llround(energy / tol);
+
+	if (++nRow == blockRow)
+		Flush();
+}
+
+void PackedWriter::Flush()
+{
+	if (nRow == 0)
+		return;
+
+	bytes.clear();
+	BitWriter bits(bytes);
+	for (int col = 0; col < nCol; ++col) {
+		int64_t * qc = q.data() + static_cast<size_t>(col) * blockRow;
+
+		// zigzag deltas, in place
+		int64_t prev = last[col];
+		last[col] = qc[nRow - 1];
+		uint64_t maxU = 0;
+		for (int i = 0; i < nRow; ++i) {
+			const int64_t cur = qc[i];
+			const uint64_t u = ZigZag(cur - prev);
+			prev = cur;
+			qc[i] = static_cast<int64_t>(u);
+			if (u > maxU)
+				maxU = u;
+		}
+
+		// fixed width, or the cheapest Rice parameter
+		const int b = BitWidth(maxU);
+		int coding = FIXED;
+		int param = b;
+		if (ifRice) {
+			uint64_t best = static_cast<uint64_t>(b) * nRow;
+			for (int k = 0; k < b; ++k) {
+				uint64_t cost = 0;
+				for (int i = 0; i < nRow && cost < best; ++i)
+					cost += (static_cast<uint64_t>(qc[i]) >> k) + 1 + k;
+				if (cost < best) {
+					best = cost;
+					coding = RICE;
+					param = k;
+				}
+			}
+		}
+
+		bits.Put(coding, 1);
+		bits.Put(param, 7);
+		for (int i = 0; i < nRow; ++i) {
+			const uint64_t u = static_cast<uint64_t>(qc[i]);
+			if (coding == FIXED) {
+				bits.Put(u, param);
+			}
+			else {
+				for (uint64_t n = u >> param; n > 0; n -= (n < 32 ? n : 32))
+					bits.Put(~0ULL, static_cast<int>(n < 32 ? n : 32));
+				bits.Put(0, 1);
+				bits.Put(u, param);
+			}
+		}
+	}
+	bits.Flush();
+
+	PutUint32(os, static_cast<uint32_t>(nRow));
+	PutUint32(os, static_cast<uint32_t>(bytes.size()));
+	os.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+	nRow = 0;
+}
+
+// ======================================================
+// ======================= reader =======================
+// ======================================================
+
+PackedReader::PackedReader(std::istream & _is)
+	:is(_is), nCol(0), tol(1.0), ifEnergy(false), name(), q(), last(), nRow(0), iRow(0), bytes()
+{
+}
+
+bool PackedReader::Open()
+{
+	string line;
+	string key;
+	int version = 0;
+	int energy = 0;
+
+	if (!getline(is, line) || (istringstream(line) >> key >> version, key != "BondAnalyze-packed" || version != 1))
+		return false;
+
+	while (getline(is, line) && line != "data") {
+		istringstream sin(line);
+		sin >> key;
+		if (key == "columns")
+			sin >> nCol;
+		else if (key == "tolerance")
+			sin >> tol;
+		else if (key == "energy")
+			sin >> energy;
+		else if (key == "names") {
+			string s;
+			while (sin >> s)
+				name.push_back(s);
+		}
+	}
+	if (line != "data" || nCol <= 0)
+		return false;
+
+	ifEnergy = (energy != 0);
+	if (ifEnergy && !name.empty())
+		name.pop_back();
+	last.assign(nCol, 0);
+	return true;
+}
+
+bool PackedReader::ReadBlock()
+{
+	uint32_t rows;
+	uint32_t nByte;
+	if (!GetUint32(is, rows) || !GetUint32(is, nByte))
+		return false;
+
+	bytes.resize(nByte);
+	if (nByte > 0 && !is.read(reinterpret_cast<char *>(bytes.data()), nByte))
+		return false;
+
+	nRow = static_cast<int>(rows);
+	iRow = 0;
+	q.resize(static_cast<size_t>(nCol) * nRow);
+
+	BitReader bits(bytes.data(), bytes.data() + bytes.size());
+	for (int col = 0; col < nCol; ++col) {
+		int64_t * qc = q.data() + static_cast<size_t>(col) * nRow;
+		const int coding = static_cast<int>(bits.Get(1));
+		const int param = static_cast<int>(bits.Get(7));
+
+		int64_t prev = last[col];
+		for (int i = 0; i < nRow; ++i) {
+			uint64_t u;
+			if (coding == FIXED) {
+				u = bits.Get(param);
+			}
+			else {
+				uint64_t n = 0;
+				while (bits.Get(1)) {
+					n++;
+					if (bits.ifEnd())
+						return false;
+				}
+				u = (n << param) | bits.Get(param);
+			}
+			prev += UnZigZag(u);
+			qc[i] = prev;
+		}
+		last[col] = prev;
+	}
+	return true;
+}
+
+bool PackedReader::ReadRow(double * row, double & energy)
+{
+	while (iRow >= nRow) {
+		if (!ReadBlock())
+			return false;
+	}
+
+	const int nValue = ColNum();
+	for (int col = 0; col < nValue; ++col)
+		row[col] = q[static_cast<size_t>(col) * nRow + iRow] * tol;
+	energy = ifEnergy ? q[static_cast<size_t>(nValue) * nRow + iRow] * tol : 0.0;
+	iRow++;
+	return true;
+}
+
+bool DecodePacked(std::istream & in, std::ostream & out, const TextOutput::Format & format)
+{
+	PackedReader reader(in);
+	if (!reader.Open())
+		return false;
+
+	TextOutput text(out, true, reader.ifHasEnergy(), format);
+	vector<string> name = reader.refName();
+	if (reader.ifHasEnergy())
+		name.push_back("Energy");
+	text.WriteHeader(name);
+
+	vector<double> row(reader.ColNum());
+	double energy;
+	while (reader.ReadRow(row.data(), energy))
+		text.WriteRow(row.data(), reader.ColNum(), energy);
+	return true;
+}
@@ -0,0 +1,90 @@
+#ifndef PACKED_H_
+#define PACKED_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "TextOutput.h"
+
+using std::string;
+
+// packed output: the rows of a table in blocks, each column quantized to a tolerance,
+// delta-encoded against the previous row and bit-packed
+//
+// text header, then binary blocks to the end of file:
+//   BondAnalyze-packed 1
+//   columns <number of columns, energy included>
+//   tolerance <tol>
+//   energy <1 if the last column is the energy, else 0>
+//   names <name of each column, separated by ' '>
+//   data
+//   <block> ...
+// block: uint32 nRow, uint32 nByte, both little-endian, then nByte bytes of bit stream, LSB first;
+// for each column of the block:
+//   1 bit     coding: 0 fixed width, 1 Rice
+//   7 bits    width b, or Rice parameter k
+//   nRow codes of zigzag(q[i] - q[i - 1]), q = llround(value / tol), q[-1] = last q of previous block, 0 at start
+//     fixed: b bits
+//     Rice:  (u >> k) 1 bits and a 0 bit, then the low k bits
+// Rice is the entropy stage: it is taken for a column of a block when it is shorter
+class PackedWriter
+{
+	std::ostream & os;
+	int nCol;
+	double tol;
+	bool ifEnergy;
+	int blockRow;
+	bool ifRice;
+
+	// quantized rows of the block, column by column
+	std::vector<int64_t> q;
+	// last q of each column in the previous block
+	std::vector<int64_t> last;
+	int nRow;
+	std::vector<uint8_t> bytes;
+
+public:
+	// name: name of each column, ifEnergy: a row has one more value, the energy
+	PackedWriter(std::ostream & _os, const std::vector<string> & name, const bool & _ifEnergy,
+		const double & _tol, const int & _blockRow = 256, const bool & _ifRice = true);
+
+	void WriteRow(const double * row, const double & energy);
+	// write the rows of the last incomplete block
+	void Flush();
+};
+
+class PackedReader
+{
+	std::istream & is;
+	int nCol;
+	double tol;
+	bool ifEnergy;
+	std::vector<string> name;
+
+	std::vector<int64_t> q;
+	std::vector<int64_t> last;
+	int nRow;
+	int iRow;
+	std::vector<uint8_t> bytes;
+
+public:
+	explicit PackedReader(std::istream & _is);
+
+	// read the text header, return false if is is not a packed output
+	bool Open();
+	// number of values in a row, energy excluded
+	inline int ColNum() const { return ifEnergy ? nCol - 1 : nCol; }
+	inline bool ifHasEnergy() const { return ifEnergy; }
+	inline const std::vector<string> & refName() const { return name; }
+	// read next row into ColNum() values and energy, return false at the end
+	bool ReadRow(double * row, double & energy);
+
+private:
+	bool ReadBlock();
+};
+
+// decode packed output to a text table, return false if in is not a packed output
+bool DecodePacked(std::istream & in, std::ostream & out, const TextOutput::Format & format = TextOutput::TEXT);
+
+#endif // !PACKED_H_
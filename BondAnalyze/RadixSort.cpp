@@ -0,0 +1,136 @@
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include "RadixSort.h"
+#include "ThreadPool.h"
+
+// 6 passes of 11 bits cover the 64 bits of a double
+constexpr int RADIX_BITS = 11;
+constexpr int RADIX_SIZE = 1 << RADIX_BITS;
+constexpr int RADIX_PASS = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+static inline uint64_t KeyBits(const double & d)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+void RadixSort(double * key, int * idx, const size_t & n, double * tmpKey, int * tmpIdx)
+{
+	if (n < 2)
+		return;
+
+	// histograms of all passes in one read
+	static thread_local size_t count[RADIX_PASS][RADIX_SIZE];
+	memset(count, 0, sizeof(count));
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t u = KeyBits(key[i]);
+		for (int p = 0; p < RADIX_PASS; ++p)
+			count[p][(u >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+	}
+
+	double * srcKey = key;
+	int * srcIdx = idx;
+	double * dstKey = tmpKey;
+	int * dstIdx = tmpIdx;
+
+	for (int p = 0; p < RADIX_PASS; ++p) {
+		const int shift = p * RADIX_BITS;
+
+		// all keys share this digit, e.g. the sign and most exponent bits
+		if (count[p][(KeyBits(srcKey[0]) >> shift) & (RADIX_SIZE - 1)] == n)
+			continue;
+
+		size_t sum = 0;
+		for (int b = 0; b < RADIX_SIZE; ++b) {
+			const size_t c = count[p][b];
+			count[p][b] = sum;
+			sum += c;
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			const size_t pos = count[p][(KeyBits(srcKey[i]) >> shift) & (RADIX_SIZE - 1)]++;
+			dstKey[pos] = srcKey[i];
+			dstIdx[pos] = srcIdx[i];
+		}
+
+		std::swap(srcKey, dstKey);
+		std::swap(srcIdx, dstIdx);
+	}
+
+	if (srcKey != key) {
+		memcpy(key, srcKey, n * sizeof(double));
+		memcpy(idx, srcIdx, n * sizeof(int));
+	}
+}
+
+// merge sorted [lo, mid) and [mid, hi) of src into dst, the left run first on equal keys
+static void Merge(const double * srcKey, const int * srcIdx, double * dstKey, int * dstIdx,
+	const size_t & lo, const size_t & mid, const size_t & hi)
+{
+	size_t i = lo;
+	size_t j = mid;
+	size_t k = lo;
+	while (i < mid && j < hi) {
+		if (srcKey[j] < srcKey[i]) {
+			dstKey[k] = srcKey[j];
+			dstIdx[k++] = srcIdx[j++];
+		}
+		else {
+			dstKey[k] = srcKey[i];
+			dstIdx[k++] = srcIdx[i++];
+		}
+	}
+	for (; i < mid; ++i, ++k) {
+		dstKey[k] = srcKey[i];
+		dstIdx[k] = srcIdx[i];
+	}
+	for (; j < hi; ++j, ++k) {
+		dstKey[k] = srcKey[j];
+		dstIdx[k] = srcIdx[j];
+	}
+}
+
+void ParallelRadixSort(double * key, int * idx, const size_t & n, double * tmpKey, int * tmpIdx, ThreadPool & pool)
+{
+	const int nPart = pool.ThreadNum();
+	if (nPart < 2 || n < 2 * static_cast<size_t>(nPart)) {
+		RadixSort(key, idx, n, tmpKey, tmpIdx);
+		return;
+	}
+
+	// part p is [n * p / nPart, n * (p + 1) / nPart)
+	const auto bound = [&](const size_t & p) { return n * p / nPart; };
+
+	pool.ParallelFor(nPart, [&](int p) {
+		const size_t lo = bound(p);
+		RadixSort(key + lo, idx + lo, bound(p + 1) - lo, tmpKey + lo, tmpIdx + lo);
+	});
+
+	double * srcKey = key;
+	int * srcIdx = idx;
+	double * dstKey = tmpKey;
+	int * dstIdx = tmpIdx;
+
+	// merge runs of width parts pairwise, an unpaired run is copied
+	for (int width = 1; width < nPart; width *= 2) {
+		const int nMerge = (nPart + 2 * width - 1) / (2 * width);
+		pool.ParallelFor(nMerge, [&](int m) {
+			const int p = 2 * width * m;
+			const size_t lo = bound(p);
+			const size_t mid = bound(std::min(p + width, nPart));
+			const size_t hi = bound(std::min(p + 2 * width, nPart));
+			Merge(srcKey, srcIdx, dstKey, dstIdx, lo, mid, hi);
+		});
+
+		std::swap(srcKey, dstKey);
+		std::swap(srcIdx, dstIdx);
+	}
+
+	if (srcKey != key) {
+		memcpy(key, srcKey, n * sizeof(double));
+		memcpy(idx, srcIdx, n * sizeof(int));
+	}
+}
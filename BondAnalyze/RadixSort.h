@@ -0,0 +1,16 @@
+#ifndef RADIXSORT_H_
+#define RADIXSORT_H_
+
+#include <cstddef>
+
+class ThreadPool;
+
+// stable LSD radix sort of non-negative keys, idx is permuted with key
+// the bit pattern of a non-negative double orders the same as the double, so the result is
+// the same ordering as std::stable_sort with operator <
+// tmpKey and tmpIdx are scratch of n elements
+void RadixSort(double * key, int * idx, const size_t & n, double * tmpKey, int * tmpIdx);
+// RadixSort of one part of key per thread of pool, then stable merges of the parts; same result as RadixSort
+void ParallelRadixSort(double * key, int * idx, const size_t & n, double * tmpKey, int * tmpIdx, ThreadPool & pool);
+
+#endif // !RADIXSORT_H_
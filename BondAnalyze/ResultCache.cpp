@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "ResultCache.h"
+
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+
+// bytes of a sampled block of the input file; SAMPLE_NUM + 1 blocks are sampled,
+// at offsets i / SAMPLE_NUM of the file, i = 0 .. SAMPLE_NUM
+constexpr size_t SAMPLE_BLOCK = 1 << 12;
+constexpr int SAMPLE_NUM = 16;
+
+// FNV-1a, two of different bases make a 128-bit key
+static inline void Hash(const void * data, const size_t & n, uint64_t h[2])
+{
+	const unsigned char * p = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < n; ++i) {
+		h[0] = (h[0] ^ p[i]) * 1099511628211ULL;
+		h[1] = (h[1] ^ p[i]) * 1099511628211ULL;
+	}
+}
+
+static bool CopyFile(const string & from, const string & to)
+{
+	ifstream fin(from.c_str(), ifstream::in | ifstream::binary);
+	if (!fin)
+		return false;
+	ofstream fout(to.c_str(), ofstream::out | ofstream::binary);
+	if (fin.peek() != ifstream::traits_type::eof())
+		fout << fin.rdbuf();
+	return static_cast<bool>(fout.flush());
+}
+
+ResultCache::ResultCache(const string & dir, const long long & maxBytes)
+	:dir(dir), maxBytes(maxBytes), entry()
+{
+	mkdir(dir.c_str(), 0777);
+}
+
+bool ResultCache::Key(const string & in_file, const string & run, const bool & ifFullHash)
+{
+	const int fd = open(in_file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+
+	uint64_t h[2] = { 14695981039346656037ULL, 0x6c62272e07bb0142ULL };
+	vector<char> buf(ifFullHash ? (1 << 16) : SAMPLE_BLOCK);
+	bool ok = true;
+
+	if (ifFullHash) {
+		ssize_t n;
+		while ((n = read(fd, buf.data(), buf.size())) > 0)
+			Hash(buf.data(), n, h);
+		ok = (n == 0);
+	}
+	else {
+		const long long stamp[3] = { static_cast<long long>(st.st_size),
+			static_cast<long long>(st.st_mtim.tv_sec), static_cast<long long>(st.st_mtim.tv_nsec) };
+		Hash(stamp, sizeof(stamp), h);
+
+		// blocks at the start, evenly inside and at the end of the file
+		for (int i = 0; i <= SAMPLE_NUM && ok; ++i) {
+			const long long offset = std::max(0LL, (st.st_size - static_cast<long long>(SAMPLE_BLOCK)) * i / SAMPLE_NUM);
+			const ssize_t n = pread(fd, buf.data(), buf.size(), offset);
+			if (n < 0)
+				ok = false;
+			else
+				Hash(buf.data(), n, h);
+		}
+	}
+	close(fd);
+	if (!ok)
+		return false;
+
+	Hash(run.data(), run.size(), h);
+
+	char name[40];
+	snprintf(name, sizeof(name), "%016llx%016llx", static_cast<unsigned long long>(h[0]), static_cast<unsigned long long>(h[1]));
+	entry = dir + "/" + name + ".res";
+	return true;
+}
+
+bool ResultCache::Fetch(const string & out_file)
+{
+	if (entry.empty() || access(entry.c_str(), R_OK) != 0)
+		return false;
+
+	if (!CopyFile(entry, out_file))
+		return false;
+	// mark as used
+	utime(entry.c_str(), nullptr);
+	return true;
+}
+
+bool ResultCache::Store(const string & out_file)
+{
+	if (entry.empty())
+		return false;
+
+	// write a temporary file, then rename, so that an entry is always complete
+	const string tmp_file = entry + ".tmp" + std::to_string(getpid());
+	if (!CopyFile(out_file, tmp_file) || rename(tmp_file.c_str(), entry.c_str()) != 0) {
+		remove(tmp_file.c_str());
+		return false;
+	}
+
+	Evict();
+	return true;
+}
+
+void ResultCache::Evict()
+{
+	struct Entry
+	{
+		string path;
+		long long size;
+		struct timespec used;
+	};
+
+	DIR * d = opendir(dir.c_str());
+	if (!d)
+		return;
+
+	vector<Entry> list;
+	long long total = 0;
+	while (const struct dirent * de = readdir(d)) {
+		const string name = de->d_name;
+		if (name.size() < 4 || name.compare(name.size() - 4, 4, ".res") != 0)
+			continue;
+
+		struct stat st;
+		const string path = dir + "/" + name;
+		if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		list.push_back({ path, static_cast<long long>(st.st_size), st.st_mtim });
+		total += st.st_size;
+	}
+	closedir(d);
+
+	if (total <= maxBytes)
+		return;
+
+	std::sort(list.begin(), list.end(), [](const Entry & a, const Entry & b) {
+		return a.used.tv_sec < b.used.tv_sec || (a.used.tv_sec == b.used.tv_sec && a.used.tv_nsec < b.used.tv_nsec);
+	});
+	for (const auto & e : list) {
+		if (total <= maxBytes)
+			break;
+		if (remove(e.path.c_str()) == 0)
+			total -= e.size;
+	}
+}
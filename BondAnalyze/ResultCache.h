@@ -0,0 +1,43 @@
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+#include <string>
+#include <cstdint>
+
+using std::string;
+
+// on-disk cache of output files, keyed by the input file and the text describing the run
+//
+//   ResultCache cache(dir, maxBytes);
+//   cache.Key(in_file, run, false);         // run: config, rules and output options
+//   if (!cache.Fetch(out_file)) {
+//       ... analyze in_file into out_file ...
+//       cache.Store(out_file);
+//   }
+//
+// an entry is <dir>/<key>.res, a copy of the output file; its mtime is the time of last use,
+// Store() removes the least recently used entries while the entries take more than maxBytes
+class ResultCache
+{
+public:
+	// dir is created if missing
+	ResultCache(const string & dir, const long long & maxBytes);
+
+	// key of in_file and run, return false if in_file can't be read;
+	// in_file is identified by its size, mtime and 17 sampled blocks, or by all of its bytes if ifFullHash
+	bool Key(const string & in_file, const string & run, const bool & ifFullHash);
+	// copy the entry of the key to out_file, return false if there is none
+	bool Fetch(const string & out_file);
+	// copy out_file to the entry of the key, then evict entries over the cap
+	bool Store(const string & out_file);
+
+private:
+	string dir;
+	long long maxBytes;
+	// path of the entry of the key
+	string entry;
+
+	void Evict();
+};
+
+#endif // !RESULTCACHE_H_
@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstring>
+#include "Series.h"
+#include "FFT.h"
+
+using std::vector;
+using std::complex;
+
+Series::Series(const Kind & _kind, const int & _nCol, const int & _segLen, const double & _dt)
+	:kind(_kind), nCol(_nCol), segLen(static_cast<int>(FFTSize(_segLen < 2 ? 2 : _segLen))), dt(_dt),
+	buf(), nBuf(0), nSeg(0), nFFT(0), nLen(0), work(), power(_nCol), count(), weight(0.0), abscissa(), result(_nCol)
+{
+	buf.resize(static_cast<size_t>(nCol) * segLen);
+}
+
+void Series::Add(const double * row)
+{
+	for (int col = 0; col < nCol; ++col)
+		buf[static_cast<size_t>(col) * segLen + nBuf] = static_cast<float>(row[col]);
+
+	if (++nBuf < segLen)
+		return;
+
+	Reduce(segLen);
+
+	// ACF: back-to-back segments; SPECTRUM: keep the second half for the next segment
+	const int keep = (kind == SPECTRUM) ? segLen / 2 : 0;
+	for (int col = 0; col < nCol && keep > 0; ++col) {
+		float * x = buf.data() + static_cast<size_t>(col) * segLen;
+		memmove(x, x + segLen - keep, keep * sizeof(float));
+	}
+	nBuf = keep;
+}
+
+void Series::Reduce(const int & n)
+{
+	if (nSeg == 0) {
+		nLen = n;
+		// ACF: zero padding to 2n keeps the circular correlation from wrapping around
+		nFFT = FFTSize(kind == ACF ? 2 * static_cast<size_t>(n) : n);
+		work.resize(nFFT);
+		for (auto & p : power)
+			p.assign(nFFT, 0.0);
+		count.assign(nLen, 0.0);
+	}
+
+	const double pi = std::acos(-1.0);
+	double scale = 1.0;
+	if (kind == ACF) {
+		for (int k = 0; k < n; ++k)
+			count[k] += n - k;
+	}
+	else {
+		// Hann window over the n frames of this segment
+		double wsum = 0.0;
+		for (int i = 0; i < n; ++i) {
+			const double w = (n > 1) ? 0.5 - 0.5 * std::cos(2 * pi * i / (n - 1)) : 1.0;
+			wsum += w * w;
+		}
+		scale = static_cast<double>(n) / nLen / wsum;
+		weight += static_cast<double>(n) / nLen;
+	}
+
+	for (int col = 0; col < nCol; ++col) {
+		const float * x = buf.data() + static_cast<size_t>(col) * segLen;
+
+		double mean = 0.0;
+		for (int i = 0; i < n; ++i)
+			mean += x[i];
+		mean /= n;
+
+		for (int i = 0; i < n; ++i) {
+			double w = 1.0;
+			if (kind == SPECTRUM && n > 1)
+				w = 0.5 - 0.5 * std::cos(2 * pi * i / (n - 1));
+			work[i] = complex<double>((x[i] - mean) * w, 0.0);
+		}
+		for (size_t i = n; i < nFFT; ++i)
+			work[i] = 0.0;
+
+		FFT(work.data(), nFFT);
+		for (size_t k = 0; k < nFFT; ++k)
+			power[col][k] += scale * std::norm(work[k]);
+	}
+	nSeg++;
+}
+
+void Series::Finish()
+{
+	// the rest as a shorter segment, if it has frames not in a segment yet: SPECTRUM keeps half a segment
+	// of the last one
+	const int keep = (kind == SPECTRUM && nSeg > 0) ? segLen / 2 : 0;
+	if (nBuf > keep && nBuf > 1)
+		Reduce(nBuf);
+	nBuf = 0;
+
+	abscissa.clear();
+	for (auto & r : result)
+		r.clear();
+	if (nSeg == 0)
+		return;
+
+	if (kind == ACF) {
+		for (int k = 0; k < nLen; ++k)
+			abscissa.push_back(k * dt);
+
+		for (int col = 0; col < nCol; ++col) {
+			for (size_t k = 0; k < nFFT; ++k)
+				work[k] = power[col][k];
+			FFT(work.data(), nFFT, true);
+
+			// unbiased: lag k over the products behind it in all segments
+			result[col].resize(nLen);
+			for (int k = 0; k < nLen; ++k)
+				result[col][k] = work[k].real() / nFFT / count[k];
+		}
+	}
+	else {
+		const size_t nFreq = nFFT / 2 + 1;
+		for (size_t k = 0; k < nFreq; ++k)
+			abscissa.push_back(k / (nFFT * dt));
+
+		for (int col = 0; col < nCol; ++col) {
+			result[col].resize(nFreq);
+			for (size_t k = 0; k < nFreq; ++k) {
+				// one-sided: double all but the zero and Nyquist frequencies
+				const double side = (k == 0 || k == nFFT / 2) ? 1.0 : 2.0;
+				result[col][k] = side * power[col][k] * dt / weight;
+			}
+		}
+	}
+}
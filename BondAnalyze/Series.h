@@ -0,0 +1,65 @@
+#ifndef SERIES_H_
+#define SERIES_H_
+
+#include <vector>
+#include <complex>
+
+// time series of the columns of a rule table, reduced by FFT in segments of segLen frames
+// so that memory doesn't grow with the trajectory:
+//   ACF       autocovariance of each column about its segment mean, lag 0 .. segLen - 1,
+//             from zero-padded FFTs of back-to-back segments, averaged over segments
+//   SPECTRUM  one-sided power spectral density (Welch): Hann window, segments overlapping by half,
+//             frequency k / (segLen * dt), k = 0 .. segLen / 2
+// the frames after the last full segment (or a series shorter than one segment) make a last, shorter segment,
+// zero-padded like the others: ACF normalizes each lag by the number of products behind it over all segments,
+// SPECTRUM windows the short segment over its own length and weights each segment by its length;
+// a last segment of a single frame has no deviation from its mean and is left out
+class Series
+{
+public:
+	enum Kind { ACF, SPECTRUM };
+
+	// segLen is rounded up to a power of 2
+	Series(const Kind & _kind, const int & _nCol, const int & _segLen, const double & _dt);
+
+	void Add(const double * row);
+	// reduce the rest, results are valid after it
+	void Finish();
+
+	// number of result rows
+	inline int RowNum() const { return static_cast<int>(abscissa.size()); }
+	// lag time or frequency of result row i
+	inline double Abscissa(const int & i) const { return abscissa[i]; }
+	// result of row i, column col
+	inline double Value(const int & i, const int & col) const { return result[col][i]; }
+	inline int SegNum() const { return nSeg; }
+
+private:
+	Kind kind;
+	int nCol;
+	int segLen;
+	double dt;
+
+	// frames of the segment being filled, column by column, as float to halve the memory
+	std::vector<float> buf;
+	int nBuf;
+	int nSeg;
+	// FFT size of the segments, fixed by the first one
+	size_t nFFT;
+	// length of the first segment
+	int nLen;
+
+	std::vector<std::complex<double>> work;
+	// sum of |FFT|^2 of each column, SPECTRUM: over the window power of the segment and weighted by its length
+	std::vector<std::vector<double>> power;
+	// ACF: products behind each lag; SPECTRUM: sum of the segment weights, 1 for a full segment
+	std::vector<double> count;
+	double weight;
+	std::vector<double> abscissa;
+	std::vector<std::vector<double>> result;
+
+	// reduce the first n frames of buf
+	void Reduce(const int & n);
+};
+
+#endif // !SERIES_H_
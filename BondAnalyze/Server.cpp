@@ -0,0 +1,486 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "Server.h"
+#include "Analyzer.h"
+#include "TextOutput.h"
+#include "XyzReader.h"
+#include "FrameFilter.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::istringstream;
+using std::ostringstream;
+
+// cache size of each worker
+constexpr size_t MAX_SCHEMA = 32;
+constexpr size_t MAX_ANALYZER = 256;
+// longest field head, and bytes of a field value read at a time
+constexpr size_t MAX_HEAD = 256;
+constexpr size_t READ_CHUNK = 1 << 20;
+// limit of a request, and seconds a worker waits for a client to send or read
+constexpr size_t MAX_REQUEST = static_cast<size_t>(1) << 30;
+constexpr int CLIENT_TIMEOUT = 30;
+
+// ======================================================
+// ====================== message =======================
+// ======================================================
+
+static bool WriteAll(const int & fd, const char * p, size_t n)
+{
+	while (n > 0) {
+		const ssize_t k = write(fd, p, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
+static bool ReadAll(const int & fd, char * p, size_t n)
+{
+	while (n > 0) {
+		const ssize_t k = read(fd, p, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
+bool WriteMessage(const int & fd, const Message & msg)
+{
+	for (const auto & field : msg) {
+		const string head = field.first + ' ' + std::to_string(field.second.size()) + '\n';
+		if (!WriteAll(fd, head.data(), head.size()) || !WriteAll(fd, field.second.data(), field.second.size()))
+			return false;
+	}
+	const string end = "end 0\n";
+	return WriteAll(fd, end.data(), end.size());
+}
+
+bool ReadMessage(const int & fd, Message & msg, const size_t & maxSize)
+{
+	msg.clear();
+	size_t total = 0;
+	for (;;) {
+		// field head, read byte by byte as it is short
+		string head;
+		char c = 0;
+		while (head.size() < MAX_HEAD && ReadAll(fd, &c, 1) && c != '\n')
+			head.push_back(c);
+		if (c != '\n')
+			return false;
+
+		const auto pos = head.rfind(' ');
+		if (pos == string::npos)
+			return false;
+		const string name = head.substr(0, pos);
+		const size_t size = strtoull(head.c_str() + pos + 1, nullptr, 10);
+		if (name == "end")
+			return true;
+		if (size > maxSize - total)
+			return false;
+		total += size;
+
+		// grown as the bytes arrive, so a size the peer doesn't send allocates nothing
+		string & value = msg[name];
+		value.clear();
+		for (size_t done = 0; done < size; ) {
+			const size_t n = std::min(size - done, READ_CHUNK);
+			value.resize(done + n);
+			if (!ReadAll(fd, &value[done], n))
+				return false;
+			done += n;
+		}
+	}
+}
+
+// ======================================================
+// ======================= worker =======================
+// ======================================================
+
+static uint64_t Hash(const string & s, uint64_t h = 14695981039346656037ULL)
+{
+	// FNV-1a
+	for (const auto & c : s) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+struct SchemaSlot
+{
+	string cfg;
+	// empty while in use, the schema is in Molecule then
+	Molecule::Schema schema;
+	long long used;
+};
+
+struct AnalyzerSlot
+{
+	uint64_t schemaKey;
+	string rules;
+	std::unique_ptr<Analyzer> analyzer;
+	// state of fresh rules, loaded before each request
+	string initState;
+	long long used;
+};
+
+class Worker
+{
+	std::map<uint64_t, SchemaSlot> schemas;
+	std::map<uint64_t, AnalyzerSlot> analyzers;
+	// key of schema in Molecule, 0 for none
+	uint64_t active;
+	long long clock;
+
+public:
+	Worker() :active(0), clock(0) {}
+
+	void Handle(const int & fd);
+
+private:
+	bool Analyze(const Message & req, string & anly, string & error);
+	bool UseSchema(const string & cfg, uint64_t & key, string & error);
+	Analyzer * UseAnalyzer(const uint64_t & schemaKey, const string & rules, const bool & ifLine, string & error);
+	void Evict();
+};
+
+void Worker::Handle(const int & fd)
+{
+	Message req;
+	Message reply;
+	if (!ReadMessage(fd, req, MAX_REQUEST))
+		return;
+
+	string anly;
+	string error;
+	if (Analyze(req, anly, error)) {
+		reply["status"] = "ok";
+		reply["anly"].swap(anly);
+	}
+	else {
+		reply["status"] = "error";
+		reply["error"] = error;
+	}
+	WriteMessage(fd, reply);
+}
+
+bool Worker::UseSchema(const string & cfg, uint64_t & key, string & error)
+{
+	key = Hash(cfg);
+	if (key == 0)
+		key = 1;
+
+	auto it = schemas.find(key);
+	if (it != schemas.end() && it->second.cfg != cfg) {
+		error = "schema hash collision";
+		return false;
+	}
+
+	if (key != active) {
+		// put the schema in use back to its slot, Molecule is empty then
+		if (active != 0)
+			Molecule::SwapSchema(schemas[active].schema);
+		active = 0;
+
+		if (it != schemas.end()) {
+			Molecule::SwapSchema(it->second.schema);
+		}
+		else {
+			istringstream sin(cfg);
+			Analyzer::LoadSchema(sin);
+			if (Molecule::totAtom <= 0) {
+				Molecule::Schema empty;
+				Molecule::SwapSchema(empty);
+				error = "invalid molecule description";
+				return false;
+			}
+			SchemaSlot & slot = schemas[key];
+			slot.cfg = cfg;
+		}
+		active = key;
+	}
+	schemas[key].used = ++clock;
+	return true;
+}
+
+Analyzer * Worker::UseAnalyzer(const uint64_t & schemaKey, const string & rules, const bool & ifLine, string & error)
+{
+	const string text = (ifLine ? "rule\n" : "rules\n") + rules;
+	const uint64_t key = Hash(text, schemaKey);
+
+	auto it = analyzers.find(key);
+	if (it != analyzers.end() && (it->second.schemaKey != schemaKey || it->second.rules != text)) {
+		error = "rule hash collision";
+		return nullptr;
+	}
+
+	if (it == analyzers.end()) {
+		std::unique_ptr<Analyzer> analyzer(new Analyzer());
+		string bad_line;
+		bool ok = true;
+		if (ifLine) {
+			ok = analyzer->AddRule(rules);
+			bad_line = rules;
+		}
+		else {
+			istringstream sin(rules);
+			ok = analyzer->AddRules(sin, &bad_line);
+		}
+		if (!ok) {
+			error = "invalid rule: " + bad_line + " (" + analyzer->RuleError() + ")";
+			return nullptr;
+		}
+		// a client mustn't make the server write files of its choosing
+		if (analyzer->ifWriteFile()) {
+			error = "rules writing a file (contactmap with a delta file) are not served";
+			return nullptr;
+		}
+		analyzer->Compile();
+
+		AnalyzerSlot & slot = analyzers[key];
+		slot.schemaKey = schemaKey;
+		slot.rules = text;
+		slot.initState = analyzer->SaveState();
+		slot.analyzer.swap(analyzer);
+		it = analyzers.find(key);
+	}
+
+	AnalyzerSlot & slot = it->second;
+	slot.used = ++clock;
+	slot.analyzer->LoadState(slot.initState);
+	return slot.analyzer.get();
+}
+
+void Worker::Evict()
+{
+	while (analyzers.size() > MAX_ANALYZER) {
+		auto lru = analyzers.begin();
+		for (auto it = analyzers.begin(); it != analyzers.end(); ++it) {
+			if (it->second.used < lru->second.used)
+				lru = it;
+		}
+		analyzers.erase(lru);
+	}
+
+	while (schemas.size() > MAX_SCHEMA) {
+		auto lru = schemas.end();
+		for (auto it = schemas.begin(); it != schemas.end(); ++it) {
+			if (it->first != active && (lru == schemas.end() || it->second.used < lru->second.used))
+				lru = it;
+		}
+		if (lru == schemas.end())
+			break;
+
+		for (auto it = analyzers.begin(); it != analyzers.end();) {
+			if (it->second.schemaKey == lru->first)
+				it = analyzers.erase(it);
+			else
+				++it;
+		}
+		schemas.erase(lru);
+	}
+}
+
+bool Worker::Analyze(const Message & req, string & anly, string & error)
+{
+	const auto field = [&req](const char * name) -> string {
+		const auto it = req.find(name);
+		return (it == req.end()) ? string() : it->second;
+	};
+
+	const string flags = field("flags");
+	const bool opt_f = flags.find('f') != string::npos;
+	const bool opt_h = flags.find('h') != string::npos;
+	const bool opt_e = flags.find('e') != string::npos;
+	const long long opt_stride = field("stride").empty() ? 1 : std::max(1LL, atoll(field("stride").c_str()));
+	const long long opt_start = atoll(field("start").c_str());
+	const long long opt_stop = field("stop").empty() ? -1 : atoll(field("stop").c_str());
+
+	FrameFilter filter;
+	if (!filter.Add(field("where"), error))
+		return false;
+
+	uint64_t schemaKey;
+	if (!UseSchema(field("cfg"), schemaKey, error))
+		return false;
+
+	Analyzer * analyzer = UseAnalyzer(schemaKey, opt_f ? field("rule") : field("rules"), opt_f, error);
+	if (!analyzer)
+		return false;
+
+	const auto it = req.find("data");
+	XyzReader reader;
+	if (it != req.end())
+		reader.OpenMemory(it->second.data(), it->second.size());
+
+	ostringstream out;
+	TextOutput text(out, opt_f ? opt_h : !opt_h, opt_f ? opt_e : !opt_e);
+	text.WriteHeader(*analyzer);
+
+	vector<double> row(analyzer->ColNum());
+	long long frame = 0;
+	int tmp;
+	while ((opt_stop < 0 || frame < opt_stop) && reader.ReadCount(tmp)) {
+		if (frame < opt_start || (frame - opt_start) % opt_stride != 0) {
+			if (!reader.SkipLines(tmp + 1LL))
+				break;
+			frame++;
+			continue;
+		}
+
+		bool ifPass;
+		if (!analyzer->ReadFrame(reader, filter, ifPass))
+			break;
+		if (!ifPass) {
+			frame++;
+			continue;
+		}
+		analyzer->Analyze(row.data());
+		text.WriteRow(row.data(), analyzer->ColNum(), analyzer->Energy());
+		frame++;
+	}
+
+	anly = out.str();
+	Evict();
+	return true;
+}
+
+// ======================================================
+// ======================= server =======================
+// ======================================================
+
+static volatile sig_atomic_t ifStop = 0;
+
+static void OnStop(int)
+{
+	ifStop = 1;
+}
+
+static pid_t StartWorker(const int & listen_fd)
+{
+	const pid_t pid = fork();
+	if (pid != 0)
+		return pid;
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+
+	Worker worker;
+	for (;;) {
+		const int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(1);
+		}
+		// a client that stops sending or reading doesn't hold the worker
+		timeval timeout = { CLIENT_TIMEOUT, 0 };
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		worker.Handle(fd);
+		close(fd);
+	}
+}
+
+int Serve(const string & socket_path, int nWorker)
+{
+	if (nWorker < 1)
+		nWorker = 1;
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path)) {
+		cerr << "BondAnalyze: socket path too long: " << socket_path << endl;
+		return 1;
+	}
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path.c_str());
+	if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 128) != 0) {
+		cerr << "BondAnalyze: listen on " << socket_path << " failed: " << strerror(errno) << endl;
+		return 1;
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = OnStop;
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	vector<pid_t> worker(nWorker);
+	for (auto & pid : worker)
+		pid = StartWorker(listen_fd);
+
+	cerr << "BondAnalyze: serving on " << socket_path << " with " << nWorker << " workers" << endl;
+
+	// restart workers that exited, e.g. on an invalid element in a request
+	while (!ifStop) {
+		int status;
+		const pid_t pid = wait(&status);
+		if (pid < 0)
+			continue;
+		for (auto & w : worker) {
+			if (w == pid && !ifStop)
+				w = StartWorker(listen_fd);
+		}
+	}
+
+	for (const auto & pid : worker)
+		kill(pid, SIGTERM);
+	while (wait(nullptr) > 0)
+		;
+
+	close(listen_fd);
+	unlink(socket_path.c_str());
+	return 0;
+}
+
+bool Request(const string & socket_path, const Message & request, Message & reply)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+		return false;
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+		close(fd);
+		return false;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	const bool ok = WriteMessage(fd, request) && ReadMessage(fd, reply);
+	close(fd);
+	return ok;
+}
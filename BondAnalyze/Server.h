@@ -0,0 +1,37 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <string>
+#include <map>
+
+using std::string;
+
+// request / reply between client and server: named fields, each field is
+//   <name> <size>\n<size bytes>
+// and the message ends with "end 0\n"
+//
+// request fields:
+//   cfg     molecule description, as in $MOLECULE_DIR/.$MOLECULE
+//   rules   rule file text (-r), or
+//   rule    one rule line (-f); rules writing a file (contactmap with a delta file) are refused
+//   flags   option letters "fhe" as on command line
+//   stride, start, stop    frame sampling
+//   where   frame predicate, see FrameFilter.h
+//   data    xyz trajectory
+// reply fields:
+//   status  "ok" or "error"
+//   anly    output text, if ok
+//   error   message, if error
+typedef std::map<string, string> Message;
+
+bool WriteMessage(const int & fd, const Message & msg);
+// fails on a message of more than maxSize bytes of field values
+bool ReadMessage(const int & fd, Message & msg, const size_t & maxSize = static_cast<size_t>(-1));
+
+// serve requests on a unix socket with nWorker worker processes, until SIGINT / SIGTERM
+// each worker caches parsed schemas and compiled rules by content hash
+int Serve(const string & socket_path, int nWorker);
+// send request to server and wait for reply, return false if connection failed
+bool Request(const string & socket_path, const Message & request, Message & reply);
+
+#endif // !SERVER_H_
@@ -0,0 +1,183 @@
+#include <cstring>
+#include <cstddef>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ShmRing.h"
+
+using std::vector;
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomic counters must be plain words in shared memory");
+static_assert(sizeof(ShmRing::Header) == 128, "header layout is documented in ShmRing.h");
+
+// slots begin on a page, a slot on a cache line
+constexpr uint64_t PAGE = 4096;
+constexpr uint64_t LINE = 64;
+// seq, frame, energy
+constexpr uint64_t SLOT_HEAD = 3 * sizeof(uint64_t);
+
+static inline uint64_t RoundUp(const uint64_t & n, const uint64_t & unit)
+{
+	return (n + unit - 1) / unit * unit;
+}
+
+ShmRing::ShmRing()
+	:base(nullptr), size(0), header(nullptr), ifProducer(false)
+{
+}
+
+ShmRing::~ShmRing()
+{
+	Close();
+}
+
+bool ShmRing::Create(const string & name, const vector<string> & colName, const uint64_t & nSlot, string & error)
+{
+	string names;
+	for (const auto & s : colName) {
+		names += s;
+		names.push_back('\0');
+	}
+
+	uint64_t n = 1;
+	while (n < nSlot)
+		n <<= 1;
+
+	const uint64_t headerSize = RoundUp(sizeof(Header) + names.size(), PAGE);
+	const uint64_t slotSize = RoundUp(SLOT_HEAD + colName.size() * sizeof(double), LINE);
+	size = headerSize + n * slotSize;
+
+	shm_unlink(name.c_str());
+	const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		error = "shared memory " + name + " create failed";
+		return false;
+	}
+	if (ftruncate(fd, size) != 0) {
+		close(fd);
+		error = "shared memory " + name + " resize failed";
+		return false;
+	}
+	void * p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		error = "shared memory " + name + " map failed";
+		return false;
+	}
+
+	// the object is zero filled: published = 0, closed = 0, seq of every slot 0
+	base = static_cast<uint8_t *>(p);
+	header = reinterpret_cast<Header *>(base);
+	ifProducer = true;
+	memcpy(header->magic, "BARING\0\0", 8);
+	header->nCol = static_cast<uint32_t>(colName.size());
+	header->headerSize = headerSize;
+	header->slotSize = slotSize;
+	header->nSlot = n;
+	header->nameSize = names.size();
+	memcpy(base + sizeof(Header), names.data(), names.size());
+	// published last: a consumer that sees the version sees the whole header and the names
+	header->version.store(1, std::memory_order_release);
+	return true;
+}
+
+void ShmRing::WriteRow(const long long & frame, const double * row, const double & energy)
+{
+	const uint64_t n = header->published.load(std::memory_order_relaxed);
+	std::atomic<uint64_t> & seq = Seq(n);
+	uint8_t * slot = reinterpret_cast<uint8_t *>(&seq);
+
+	seq.store(2 * n + 1, std::memory_order_relaxed);
+	// the odd seq is seen before any byte of the row changes
+	std::atomic_thread_fence(std::memory_order_release);
+
+	const int64_t f = frame;
+	memcpy(slot + sizeof(uint64_t), &f, sizeof(f));
+	memcpy(slot + 2 * sizeof(uint64_t), &energy, sizeof(energy));
+	memcpy(slot + SLOT_HEAD, row, header->nCol * sizeof(double));
+
+	seq.store(2 * n + 2, std::memory_order_release);
+	header->published.store(n + 1, std::memory_order_release);
+}
+
+bool ShmRing::Attach(const string & name, string & error)
+{
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		error = "shared memory " + name + " open failed";
+		return false;
+	}
+
+	struct stat st;
+	void * p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header))
+		p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		error = "shared memory " + name + " map failed";
+		return false;
+	}
+
+	base = static_cast<uint8_t *>(p);
+	size = st.st_size;
+	header = reinterpret_cast<Header *>(base);
+	ifProducer = false;
+	// version 0 while the producer is still writing the header
+	if (header->version.load(std::memory_order_acquire) != 1 || memcmp(header->magic, "BARING\0\0", 8) != 0
+		|| header->headerSize + header->nSlot * header->slotSize > size) {
+		Close();
+		error = "shared memory " + name + " is not a BondAnalyze ring";
+		return false;
+	}
+	return true;
+}
+
+const double * ShmRing::Row(const uint64_t & n, long long & frame, double & energy) const
+{
+	if (n >= Published())
+		return nullptr;
+
+	const std::atomic<uint64_t> & seq = Seq(n);
+	if (seq.load(std::memory_order_acquire) != 2 * n + 2)
+		return nullptr;
+
+	const uint8_t * slot = reinterpret_cast<const uint8_t *>(&seq);
+	int64_t f;
+	memcpy(&f, slot + sizeof(uint64_t), sizeof(f));
+	memcpy(&energy, slot + 2 * sizeof(uint64_t), sizeof(energy));
+	frame = f;
+	return reinterpret_cast<const double *>(slot + SLOT_HEAD);
+}
+
+bool ShmRing::Check(const uint64_t & n) const
+{
+	// the reads of the row are done before seq is read again
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return Seq(n).load(std::memory_order_relaxed) == 2 * n + 2;
+}
+
+vector<string> ShmRing::ColName() const
+{
+	vector<string> name;
+	const char * p = reinterpret_cast<const char *>(base + sizeof(Header));
+	const char * end = p + header->nameSize;
+	while (p < end) {
+		name.push_back(p);
+		p += name.back().size() + 1;
+	}
+	return name;
+}
+
+void ShmRing::Close()
+{
+	if (!base)
+		return;
+
+	if (ifProducer)
+		header->closed.store(1, std::memory_order_release);
+	munmap(base, size);
+	base = nullptr;
+	header = nullptr;
+	size = 0;
+}
@@ -0,0 +1,87 @@
+#ifndef SHMRING_H_
+#define SHMRING_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+using std::string;
+
+// binary rows in a POSIX shared memory ring buffer, one producer and any number of consumers
+//
+// shared memory object (shm_open name), native byte order:
+//   offset 0            Header: magic "BARING\0\0", uint32 version 1, uint32 nCol, uint64 headerSize, slotSize,
+//                       nSlot, nameSize, 2 reserved; at offset 64 uint64 published, at offset 72 uint64 closed
+//   offset 128          column names, each ending with '\0', nameSize bytes
+//   offset headerSize   nSlot slots of slotSize bytes, row n in slot n % nSlot
+// slot:
+//   uint64 seq          2n + 1 while row n is being written, 2n + 2 once it is complete
+//   int64 frame         index of the frame in input
+//   double energy
+//   double value[nCol]  the row: one value per rule, or the sorted lengths of each BondType
+//
+// producer: the header and the column names are written first, then version = 1 (release); a consumer
+// loads version (acquire) before any other field, so a ring still being created is not attached
+// producer of row n: seq = 2n + 1, write frame / energy / value, seq = 2n + 2 (release),
+// published = n + 1 (release); it never waits for consumers
+// consumer of row n: wait until published > n (acquire), check seq == 2n + 2 (acquire), use the row in place,
+// then check seq again (after an acquire fence); a changed seq means the producer has come round
+// and overwritten the row, i.e. the consumer fell more than nSlot rows behind: skip to published - nSlot
+class ShmRing
+{
+public:
+	struct Header
+	{
+		// "BARING\0\0"
+		char magic[8];
+		// 1, stored last by the producer
+		std::atomic<uint32_t> version;
+		uint32_t nCol;
+		uint64_t headerSize;
+		uint64_t slotSize;
+		uint64_t nSlot;
+		uint64_t nameSize;
+		uint64_t reserved[2];
+		// rows written
+		alignas(64) std::atomic<uint64_t> published;
+		// 1 once the producer is done
+		std::atomic<uint64_t> closed;
+	};
+
+	ShmRing();
+	~ShmRing();
+
+	// producer: create the object name (replacing an old one) for rows of the named columns, nSlot rounded up to a power of 2
+	bool Create(const string & name, const std::vector<string> & colName, const uint64_t & nSlot, string & error);
+	void WriteRow(const long long & frame, const double * row, const double & energy);
+
+	// consumer: map an object created by a producer, read only
+	bool Attach(const string & name, string & error);
+	// consumer: the values of row n in place, nullptr if row n isn't published or is overwritten;
+	// frame and energy of the row are stored
+	const double * Row(const uint64_t & n, long long & frame, double & energy) const;
+	// consumer: whether row n is still intact, after its values are used
+	bool Check(const uint64_t & n) const;
+	inline uint64_t Published() const { return header->published.load(std::memory_order_acquire); }
+	inline bool ifClosed() const { return header->closed.load(std::memory_order_acquire) != 0; }
+	inline int ColNum() const { return static_cast<int>(header->nCol); }
+	inline uint64_t SlotNum() const { return header->nSlot; }
+	// names of the columns
+	std::vector<string> ColName() const;
+
+	// unmap; a producer marks the ring closed first, the object stays for the consumers, shm_unlink it when done
+	void Close();
+
+private:
+	uint8_t * base;
+	size_t size;
+	Header * header;
+	bool ifProducer;
+
+	inline std::atomic<uint64_t> & Seq(const uint64_t & n) const {
+		return *reinterpret_cast<std::atomic<uint64_t> *>(base + header->headerSize + (n & (header->nSlot - 1)) * header->slotSize);
+	}
+};
+
+#endif // !SHMRING_H_
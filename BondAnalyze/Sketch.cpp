@@ -0,0 +1,125 @@
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include "Sketch.h"
+
+using std::vector;
+using std::pair;
+
+Sketch::Sketch(const int & _k, const uint64_t & seed)
+	:k(std::max(_k, 8)), random(seed * 0x9E3779B97F4A7C15ULL | 1), level(), cap(), nHeld(0), nCap(0), n(0),
+	vmin(std::numeric_limits<double>::infinity()), vmax(-std::numeric_limits<double>::infinity()), variance(0.0)
+{
+	Grow();
+}
+
+void Sketch::Grow()
+{
+	level.emplace_back();
+	cap.resize(level.size());
+	nCap = 0;
+	for (int h = 0; h < static_cast<int>(level.size()); ++h) {
+		const int depth = static_cast<int>(level.size()) - 1 - h;
+		cap[h] = std::max(2, static_cast<int>(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+		nCap += cap[h];
+	}
+}
+
+void Sketch::Add(const double & v)
+{
+	// NaN has no rank
+	if (v != v)
+		return;
+
+	level[0].push_back(v);
+	vmin = std::min(vmin, v);
+	vmax = std::max(vmax, v);
+	n++;
+	if (++nHeld >= nCap)
+		Compress();
+}
+
+void Sketch::Add(const double * v, const int & num)
+{
+	for (int i = 0; i < num; ++i)
+		Add(v[i]);
+}
+
+void Sketch::Compress()
+{
+	for (int h = 0; h < static_cast<int>(level.size()); ++h) {
+		if (static_cast<int>(level[h].size()) < cap[h])
+			continue;
+
+		if (h + 1 == static_cast<int>(level.size()))
+			Grow();
+
+		vector<double> & cur = level[h];
+		vector<double> & up = level[h + 1];
+		std::sort(cur.begin(), cur.end());
+
+		// an odd value out stays
+		const size_t m = cur.size() & ~static_cast<size_t>(1);
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		for (size_t i = random & 1; i < m; i += 2)
+			up.push_back(cur[i]);
+		cur.erase(cur.begin(), cur.begin() + m);
+
+		nHeld -= m / 2;
+		variance += std::ldexp(1.0, 2 * h);
+		return;
+	}
+}
+
+void Sketch::Merge(const Sketch & other)
+{
+	while (level.size() < other.level.size())
+		Grow();
+	for (size_t h = 0; h < other.level.size(); ++h)
+		level[h].insert(level[h].end(), other.level[h].begin(), other.level[h].end());
+
+	nHeld += other.nHeld;
+	n += other.n;
+	vmin = std::min(vmin, other.vmin);
+	vmax = std::max(vmax, other.vmax);
+	variance += other.variance;
+	while (nHeld >= nCap)
+		Compress();
+}
+
+double Sketch::Quantile(const double & q) const
+{
+	if (n == 0)
+		return std::numeric_limits<double>::quiet_NaN();
+	if (q <= 0.0)
+		return vmin;
+	if (q >= 1.0)
+		return vmax;
+
+	vector<pair<double, long long>> item;
+	item.reserve(nHeld);
+	for (size_t h = 0; h < level.size(); ++h) {
+		for (const double & v : level[h])
+			item.emplace_back(v, 1LL << h);
+	}
+	std::sort(item.begin(), item.end());
+
+	// the weights add up to n
+	const double rank = q * n;
+	long long sum = 0;
+	for (const auto & it : item) {
+		sum += it.second;
+		if (sum >= rank)
+			return it.first;
+	}
+	return vmax;
+}
+
+double Sketch::RankError() const
+{
+	// P(|error| >= t) <= 2 exp(-t^2 / (2 variance)) = 1%
+	return (n > 0) ? std::sqrt(2.0 * std::log(200.0) * variance) / n : 0.0;
+}
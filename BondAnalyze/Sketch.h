@@ -0,0 +1,56 @@
+#ifndef SKETCH_H_
+#define SKETCH_H_
+
+#include <vector>
+#include <cstdint>
+
+// KLL quantile sketch of a stream of values, in memory independent of the stream length
+//
+// level h keeps values of weight 2^h, the top level at most k of them and each level below 2/3 of the one above
+// (at least 2); a full level is sorted and every other value, from a random first one, moves up with twice the
+// weight; so the sketch holds about 3k values, and sketches of parts of a stream merge level by level into one
+// sketch of the whole stream
+//
+// error bound: a compaction at level h moves the rank of a value by 0 or +-2^h at random with mean 0, so by
+// Hoeffding's inequality the rank of a quantile is off by more than RankError() * Count() with probability
+// below 1%; it is about 2.5 / k of the count, 1.2% for k = 200
+class Sketch
+{
+public:
+	// k: values of the top level, at least 8; seed: of the random compactions, so that results are reproducible
+	explicit Sketch(const int & _k = 200, const uint64_t & seed = 1);
+
+	void Add(const double & v);
+	void Add(const double * v, const int & num);
+	// add the values of other, a sketch of the same k
+	void Merge(const Sketch & other);
+
+	// number of values added
+	inline long long Count() const { return n; }
+	// value of rank q * Count(), q in [0, 1], exact min / max for q = 0 / 1, NaN if empty
+	double Quantile(const double & q) const;
+	// bound of the normalized rank error of Quantile(), see above
+	double RankError() const;
+
+private:
+	int k;
+	uint64_t random;
+	std::vector<std::vector<double>> level;
+	// capacity of each level
+	std::vector<int> cap;
+	// values held, and the number of them that starts a compaction
+	long long nHeld;
+	long long nCap;
+	long long n;
+	double vmin;
+	double vmax;
+	// sum of 4^h over the compactions
+	double variance;
+
+	// compact the lowest full level
+	void Compress();
+	// add a top level
+	void Grow();
+};
+
+#endif // !SKETCH_H_
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include "Telemetry.h"
+#include "ThreadPool.h"
+
+using std::chrono::duration;
+
+static const char * const STAGE_NAME[Telemetry::NSTAGE] = { "read", "analyze", "write" };
+
+Telemetry::Telemetry()
+	:frames(0), bytesRead(0), bytesWritten(0), metrics_file(), ifStatus(false), interval(1000),
+	running(false), ifStop(false), thread(), lock(), wake(), start(), lastTime(), lastFrames(0), lastBytesRead(0)
+{
+	for (auto & ns : stageNs)
+		ns = 0;
+}
+
+Telemetry::~Telemetry()
+{
+	Stop();
+}
+
+void Telemetry::Start(const string & _metrics_file, const bool & _ifStatus, const double & _interval)
+{
+	metrics_file = _metrics_file;
+	ifStatus = _ifStatus;
+	interval = std::chrono::milliseconds(static_cast<long long>((_interval > 0.01 ? _interval : 0.01) * 1000));
+	start = lastTime = Clock::now();
+	ifStop = false;
+	running = true;
+	thread = std::thread(&Telemetry::Loop, this);
+}
+
+void Telemetry::Stop()
+{
+	if (!running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		ifStop = true;
+	}
+	wake.notify_all();
+	thread.join();
+	running = false;
+
+	Write(true);
+}
+
+void Telemetry::Loop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (!wake.wait_for(guard, interval, [this] { return ifStop; })) {
+		guard.unlock();
+		Write(false);
+		guard.lock();
+	}
+}
+
+void Telemetry::Write(const bool & ifFinal)
+{
+	const Clock::time_point now = Clock::now();
+	const long long nFrame = frames;
+	const long long nRead = bytesRead;
+	const long long nWritten = bytesWritten;
+	const double uptime = duration<double>(now - start).count();
+	const double dt = duration<double>(now - lastTime).count();
+	// rates over the last interval, over the whole run at the end
+	const double frameRate = ifFinal ? (uptime > 0 ? nFrame / uptime : 0) : (dt > 0 ? (nFrame - lastFrames) / dt : 0);
+	const double readRate = ifFinal ? (uptime > 0 ? nRead / uptime : 0) : (dt > 0 ? (nRead - lastBytesRead) / dt : 0);
+	lastTime = now;
+	lastFrames = nFrame;
+	lastBytesRead = nRead;
+
+	if (!metrics_file.empty()) {
+		const string tmp_file = metrics_file + ".tmp";
+		FILE * fp = fopen(tmp_file.c_str(), "w");
+		if (fp) {
+			fprintf(fp, "# HELP bondanalyze_frames_total Frames analyzed.\n");
+			fprintf(fp, "# TYPE bondanalyze_frames_total counter\n");
+			fprintf(fp, "bondanalyze_frames_total %lld\n", nFrame);
+			fprintf(fp, "# HELP bondanalyze_read_bytes_total Bytes of input consumed.\n");
+			fprintf(fp, "# TYPE bondanalyze_read_bytes_total counter\n");
+			fprintf(fp, "bondanalyze_read_bytes_total %lld\n", nRead);
+			fprintf(fp, "# HELP bondanalyze_written_bytes_total Bytes of output written.\n");
+			fprintf(fp, "# TYPE bondanalyze_written_bytes_total counter\n");
+			fprintf(fp, "bondanalyze_written_bytes_total %lld\n", nWritten);
+			fprintf(fp, "# HELP bondanalyze_stage_seconds_total Time spent in each stage of a frame.\n");
+			fprintf(fp, "# TYPE bondanalyze_stage_seconds_total counter\n");
+			for (int s = 0; s < NSTAGE; ++s)
+				fprintf(fp, "bondanalyze_stage_seconds_total{stage=\"%s\"} %.6f\n", STAGE_NAME[s], stageNs[s] * 1e-9);
+			fprintf(fp, "# HELP bondanalyze_frames_per_second Frames analyzed per second over the last interval.\n");
+			fprintf(fp, "# TYPE bondanalyze_frames_per_second gauge\n");
+			fprintf(fp, "bondanalyze_frames_per_second %.3f\n", frameRate);
+			fprintf(fp, "# HELP bondanalyze_thread_pool_queue_depth Tasks waiting in the thread pool queues.\n");
+			fprintf(fp, "# TYPE bondanalyze_thread_pool_queue_depth gauge\n");
+			fprintf(fp, "bondanalyze_thread_pool_queue_depth %d\n", ThreadPool::PendingAll());
+			fprintf(fp, "# HELP bondanalyze_uptime_seconds Seconds since the run started.\n");
+			fprintf(fp, "# TYPE bondanalyze_uptime_seconds gauge\n");
+			fprintf(fp, "bondanalyze_uptime_seconds %.3f\n", uptime);
+			fprintf(fp, "# HELP bondanalyze_done Whether the run has finished.\n");
+			fprintf(fp, "# TYPE bondanalyze_done gauge\n");
+			fprintf(fp, "bondanalyze_done %d\n", ifFinal ? 1 : 0);
+
+			if (fclose(fp) == 0)
+				rename(tmp_file.c_str(), metrics_file.c_str());
+		}
+	}
+
+	if (ifStatus) {
+		fprintf(stderr, "\rBondAnalyze: %lld frames, %.1f frames/s, %.1f MB read (%.1f MB/s), %.1f MB written%s",
+			nFrame, frameRate, nRead / 1e6, readRate / 1e6, nWritten / 1e6, ifFinal ? "\n" : "");
+		fflush(stderr);
+	}
+}
+
+CountingBuf::int_type CountingBuf::overflow(int_type c)
+{
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	count.fetch_add(1, std::memory_order_relaxed);
+	return sink->sputc(traits_type::to_char_type(c));
+}
+
+std::streamsize CountingBuf::xsputn(const char * s, std::streamsize n)
+{
+	const std::streamsize k = sink->sputn(s, n);
+	count.fetch_add(k, std::memory_order_relaxed);
+	return k;
+}
+
+int CountingBuf::sync()
+{
+	return sink->pubsync();
+}
@@ -0,0 +1,84 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <string>
+#include <streambuf>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using std::string;
+
+// counters of a run, written every interval by a background thread
+//   - to a file in Prometheus text exposition format, replaced atomically, for a textfile collector
+//   - and / or as a status line on stderr
+// the analyzing thread only adds to atomic counters
+class Telemetry
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	enum Stage { READ, ANALYZE, WRITE, NSTAGE };
+
+	// frames analyzed
+	std::atomic<long long> frames;
+	// bytes of input consumed, including skipped frames
+	std::atomic<long long> bytesRead;
+	// bytes of output, see CountingBuf
+	std::atomic<long long> bytesWritten;
+
+	Telemetry();
+	~Telemetry();
+
+	// start the thread, metrics_file may be empty
+	void Start(const string & metrics_file, const bool & ifStatus, const double & interval);
+	// write the final values and stop the thread
+	void Stop();
+
+	inline bool ifEnabled() const { return running; }
+	// add time since t0 to stage, return now
+	inline Clock::time_point Lap(const Stage & stage, const Clock::time_point & t0) {
+		const Clock::time_point t1 = Clock::now();
+		stageNs[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		return t1;
+	}
+
+private:
+	std::atomic<long long> stageNs[NSTAGE];
+
+	string metrics_file;
+	bool ifStatus;
+	std::chrono::milliseconds interval;
+	bool running;
+	bool ifStop;
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	Clock::time_point start;
+	// values at the last write, for rates
+	Clock::time_point lastTime;
+	long long lastFrames;
+	long long lastBytesRead;
+
+	void Loop();
+	void Write(const bool & ifFinal);
+};
+
+// streambuf counting the bytes passed to another streambuf
+class CountingBuf : public std::streambuf
+{
+	std::streambuf * sink;
+	std::atomic<long long> & count;
+
+public:
+	CountingBuf(std::streambuf * _sink, std::atomic<long long> & _count) :sink(_sink), count(_count) {}
+
+protected:
+	int_type overflow(int_type c) override;
+	std::streamsize xsputn(const char * s, std::streamsize n) override;
+	int sync() override;
+};
+
+#endif // !TELEMETRY_H_
@@ -0,0 +1,106 @@
+#include <iomanip>
+#include "TextOutput.h"
+#include "Analyzer.h"
+
+using std::endl;
+using std::setw;
+using std::left;
+using std::string;
+using std::vector;
+
+constexpr int BLANK = 2;
+constexpr int DATAWIDTH = 15;
+constexpr int DATAPRECISION = 6;
+
+TextOutput::TextOutput(std::ostream & _os, const bool & _ifHeader, const bool & _ifEnergy, const Format & _format)
+	:os(_os), ifHeader(_ifHeader), ifEnergy(_ifEnergy), format(_format)
+{
+	os << std::setprecision(DATAPRECISION);
+}
+
+void TextOutput::WriteHeader(const Analyzer & analyzer)
+{
+	if (!ifHeader)
+		return;
+
+	if (format == CSV) {
+		vector<string> name;
+		for (int i = 0; i < analyzer.ColNum(); ++i)
+			name.push_back(analyzer.ColName(i));
+		if (ifEnergy)
+			name.push_back("Energy");
+		WriteHeader(name);
+		return;
+	}
+
+	os << setw(BLANK) << left << '#';
+	for (int i = 0; i < analyzer.ColNum(); ++i) {
+		os << setw(DATAWIDTH) << left << analyzer.ColName(i);
+	}
+	if (ifEnergy)
+		os << "Energy" << endl;
+	else
+		os << endl;
+}
+
+void TextOutput::WriteHeader(const vector<string> & name)
+{
+	if (!ifHeader)
+		return;
+
+	if (format == CSV) {
+		for (size_t i = 0; i < name.size(); ++i)
+			os << (i ? "," : "") << name[i];
+		os << endl;
+		return;
+	}
+
+	os << setw(BLANK) << left << '#';
+	for (const auto & s : name) {
+		os << setw(DATAWIDTH) << left << s;
+	}
+	os << endl;
+}
+
+void TextOutput::WriteRow(const double * row, const int & nCol, const double & energy)
+{
+	if (format == CSV) {
+		for (int i = 0; i < nCol; ++i)
+			os << (i ? "," : "") << row[i];
+		if (ifEnergy)
+			os << (nCol ? "," : "") << energy;
+		os << endl;
+		return;
+	}
+
+	if (ifHeader)
+		os << setw(BLANK) << left << ' ';
+	for (int i = 0; i < nCol; ++i) {
+		os << setw(DATAWIDTH) << left << row[i];
+	}
+	if (ifEnergy)
+		os << energy << endl;
+	else
+		os << endl;
+}
+
+void TextOutput::WriteRow(const vector<string> & label, const double * row, const int & nCol)
+{
+	if (format == CSV) {
+		for (size_t i = 0; i < label.size(); ++i)
+			os << (i ? "," : "") << label[i];
+		for (int i = 0; i < nCol; ++i)
+			os << (i || !label.empty() ? "," : "") << row[i];
+		os << endl;
+		return;
+	}
+
+	if (ifHeader)
+		os << setw(BLANK) << left << ' ';
+	for (const auto & s : label)
+		os << setw(DATAWIDTH) << left << s;
+	for (int i = 0; i < nCol; ++i) {
+		os << setw(DATAWIDTH) << left << row[i];
+	}
+	os << endl;
+}
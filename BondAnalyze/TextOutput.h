@@ -0,0 +1,34 @@
+#ifndef TEXTOUTPUT_H_
+#define TEXTOUTPUT_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+class Analyzer;
+
+// .anly text table: a '#' header line of column names, then one row per frame, energy in the last column
+// or the same table as csv: a plain header line, values separated by ','
+class TextOutput
+{
+public:
+	enum Format { TEXT, CSV };
+
+private:
+	std::ostream & os;
+	bool ifHeader;
+	bool ifEnergy;
+	Format format;
+
+public:
+	TextOutput(std::ostream & _os, const bool & _ifHeader, const bool & _ifEnergy, const Format & _format = TEXT);
+
+	void WriteHeader(const Analyzer & analyzer);
+	// header of any columns, energy column not added
+	void WriteHeader(const std::vector<std::string> & name);
+	void WriteRow(const double * row, const int & nCol, const double & energy);
+	// row led by text fields, energy column not added
+	void WriteRow(const std::vector<std::string> & label, const double * row, const int & nCol);
+};
+
+#endif // !TEXTOUTPUT_H_
@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+
+// index of the queue of this thread in its pool, 0 for threads outside the pool
+static thread_local const ThreadPool * selfPool = nullptr;
+static thread_local int selfIndex = 0;
+
+std::atomic<int> ThreadPool::totalPending(0);
+
+void ThreadPool::Queue::Push(const Task & t)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (tail - head == buf.size()) {
+		// grow, keeping tasks in order; at most a few times while warming up
+		std::vector<Task> bigger(2 * buf.size());
+		for (size_t k = head; k < tail; ++k)
+			bigger[k - head] = buf[k % buf.size()];
+		buf.swap(bigger);
+		tail -= head;
+		head = 0;
+	}
+	buf[tail++ % buf.size()] = t;
+}
+
+bool ThreadPool::Queue::PopBack(Task & t)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (head == tail)
+		return false;
+	t = buf[--tail % buf.size()];
+	return true;
+}
+
+bool ThreadPool::Queue::PopFront(Task & t)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (head == tail)
+		return false;
+	t = buf[head++ % buf.size()];
+	return true;
+}
+
+ThreadPool::ThreadPool(const int & nThread)
+	:queue(), worker(), sleep_lock(), wake(), pending(0), ifStop(false)
+{
+	const int n = (nThread < 1) ? 1 : nThread;
+	for (int i = 0; i < n; ++i)
+		queue.emplace_back(new Queue());
+	for (int i = 1; i < n; ++i)
+		worker.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleep_lock);
+		ifStop = true;
+	}
+	wake.notify_all();
+	for (auto & w : worker)
+		w.join();
+}
+
+int ThreadPool::Self() const
+{
+	return (selfPool == this) ? selfIndex : 0;
+}
+
+void ThreadPool::Start(Job & job, const int & n)
+{
+	Queue & own = *queue[Self()];
+	pending += n;
+	totalPending.fetch_add(n, std::memory_order_relaxed);
+	// pushed in reverse, so the owner pops task 0 first and thieves take the last ones
+	for (int i = n - 1; i >= 0; --i)
+		own.Push(Task{ &job, i });
+
+	{
+		std::lock_guard<std::mutex> guard(sleep_lock);
+	}
+	wake.notify_all();
+}
+
+void ThreadPool::Finish(Job & job)
+{
+	const int self = Self();
+	while (job.remaining.load(std::memory_order_acquire) > 0) {
+		if (!RunOne(self))
+			std::this_thread::yield();
+	}
+}
+
+bool ThreadPool::RunOne(const int & self)
+{
+	Task t;
+	bool found = queue[self]->PopBack(t);
+	for (size_t k = 1; !found && k < queue.size(); ++k)
+		found = queue[(self + k) % queue.size()]->PopFront(t);
+	if (!found)
+		return false;
+
+	pending--;
+	totalPending.fetch_sub(1, std::memory_order_relaxed);
+	t.job->run(t.job->fn, t.i);
+	t.job->remaining.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void ThreadPool::WorkerLoop(const int & self)
+{
+	selfPool = this;
+	selfIndex = self;
+
+	for (;;) {
+		if (RunOne(self))
+			continue;
+
+		std::unique_lock<std::mutex> guard(sleep_lock);
+		wake.wait(guard, [this] { return ifStop || pending.load() > 0; });
+		if (ifStop)
+			return;
+	}
+}
@@ -0,0 +1,97 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// work-stealing thread pool for the parts of a frame that split into independent tasks
+//
+//   pool.ParallelFor(n, [&](int i) { ... });    // runs task 0 .. n-1, returns when all are done
+//
+// each thread has a queue of tasks: it runs its own tasks newest first and, when idle, steals the
+// oldest task of another queue; the calling thread runs tasks too while it waits, so ParallelFor
+// may be nested inside a task
+class ThreadPool
+{
+public:
+	// nThread threads including the caller, 1 for serial
+	explicit ThreadPool(const int & nThread);
+	~ThreadPool();
+
+	inline int ThreadNum() const { return static_cast<int>(queue.size()); }
+	// tasks waiting in the queues of all pools
+	static inline int PendingAll() { return totalPending.load(std::memory_order_relaxed); }
+
+	template<typename Fn>
+	void ParallelFor(const int & n, const Fn & fn);
+
+private:
+	struct Job
+	{
+		void (*run)(const void * fn, int i);
+		const void * fn;
+		std::atomic<int> remaining;
+	};
+
+	struct Task
+	{
+		Job * job;
+		int i;
+	};
+
+	// ring buffer of tasks, the owner pushes and pops at the back, thieves pop at the front
+	struct Queue
+	{
+		std::mutex lock;
+		std::vector<Task> buf;
+		size_t head;
+		size_t tail;
+
+		Queue() :lock(), buf(64), head(0), tail(0) {}
+		void Push(const Task & t);
+		bool PopBack(Task & t);
+		bool PopFront(Task & t);
+	};
+
+	std::vector<std::unique_ptr<Queue>> queue;
+	std::vector<std::thread> worker;
+	std::mutex sleep_lock;
+	std::condition_variable wake;
+	// tasks pushed but not yet taken
+	std::atomic<int> pending;
+	bool ifStop;
+	static std::atomic<int> totalPending;
+
+	void Start(Job & job, const int & n);
+	void Finish(Job & job);
+	// run one task of any queue, return false if there was none
+	bool RunOne(const int & self);
+	void WorkerLoop(const int & self);
+	int Self() const;
+};
+
+template<typename Fn>
+void ThreadPool::ParallelFor(const int & n, const Fn & fn)
+{
+	if (n <= 0)
+		return;
+	if (n == 1 || queue.size() == 1) {
+		for (int i = 0; i < n; ++i)
+			fn(i);
+		return;
+	}
+
+	Job job;
+	job.run = [](const void * f, int i) { (*static_cast<const Fn *>(f))(i); };
+	job.fn = &fn;
+	job.remaining = n;
+
+	Start(job, n);
+	Finish(job);
+}
+
+#endif // !THREADPOOL_H_
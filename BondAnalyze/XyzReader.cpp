@@ -0,0 +1,234 @@
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "XyzReader.h"
+
+constexpr size_t BUFSIZE = 1 << 20;
+
+XyzReader::XyzReader()
+	:fd(-1), ownFd(false), ifEof(true), buf(BUFSIZE + 1), beg(0), end(0), bufOffset(0)
+{
+	buf[0] = '\0';
+}
+
+XyzReader::~XyzReader()
+{
+	Close();
+}
+
+bool XyzReader::Open(const string & file)
+{
+	Close();
+
+	fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	ownFd = true;
+	ifEof = false;
+	return true;
+}
+
+void XyzReader::OpenFd(const int & _fd)
+{
+	Close();
+
+	fd = _fd;
+	ownFd = false;
+	ifEof = false;
+}
+
+void XyzReader::OpenMemory(const char * data, const size_t & size)
+{
+	Close();
+
+	if (buf.size() < size + 1)
+		buf.resize(size + 1);
+	memcpy(buf.data(), data, size);
+	end = size;
+	buf[end] = '\0';
+}
+
+void XyzReader::Close()
+{
+	if (ownFd && fd >= 0)
+		close(fd);
+
+	fd = -1;
+	ownFd = false;
+	ifEof = true;
+	beg = end = 0;
+	bufOffset = 0;
+	buf[0] = '\0';
+}
+
+bool XyzReader::Fill()
+{
+	if (ifEof)
+		return false;
+
+	// move unread data to front, grow if a single line fills the whole buffer
+	if (beg > 0) {
+		memmove(buf.data(), buf.data() + beg, end - beg);
+		bufOffset += beg;
+		end -= beg;
+		beg = 0;
+	}
+	if (end + 1 >= buf.size())
+		buf.resize(buf.size() * 2);
+
+	ssize_t n;
+	do {
+		n = read(fd, buf.data() + end, buf.size() - 1 - end);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0) {
+		ifEof = true;
+		buf[end] = '\0';
+		return false;
+	}
+
+	end += n;
+	buf[end] = '\0';
+	return true;
+}
+
+bool XyzReader::ReadLine(const char *& b, const char *& e)
+{
+	size_t scan = beg;
+	for (;;) {
+		const char * nl = static_cast<const char *>(memchr(buf.data() + scan, '\n', end - scan));
+		if (nl) {
+			b = buf.data() + beg;
+			e = nl;
+			beg = nl - buf.data() + 1;
+			return true;
+		}
+
+		scan = end - beg;
+		if (!Fill()) {
+			// last line without '\n'
+			if (beg == end)
+				return false;
+			b = buf.data() + beg;
+			e = buf.data() + end;
+			beg = end;
+			return true;
+		}
+	}
+}
+
+bool XyzReader::ReadCount(int & count)
+{
+	const char * b;
+	const char * e;
+	while (ReadLine(b, e)) {
+		char * stop;
+		const long n = strtol(b, &stop, 10);
+		if (stop != b) {
+			count = static_cast<int>(n);
+			return true;
+		}
+
+		// blank line between frames
+		while (b < e && (*b == ' ' || *b == '\t' || *b == '\r'))
+			++b;
+		if (b != e)
+			return false;
+	}
+	return false;
+}
+
+bool XyzReader::SkipLines(long long n)
+{
+	while (n > 0) {
+		const char * nl = static_cast<const char *>(memchr(buf.data() + beg, '\n', end - beg));
+		if (nl) {
+			beg = nl - buf.data() + 1;
+			--n;
+			continue;
+		}
+
+		// nothing in buffer is needed any more
+		bufOffset += end;
+		beg = end = 0;
+		if (!Fill())
+			return false;
+	}
+	return true;
+}
+
+bool XyzReader::Seek(const long long & offset)
+{
+	if (fd < 0 || lseek(fd, offset, SEEK_SET) < 0)
+		return false;
+
+	ifEof = false;
+	beg = end = 0;
+	bufOffset = offset;
+	buf[0] = '\0';
+	return true;
+}
+
+static inline bool IsBlankLine(const char * b, const char * e)
+{
+	while (b < e && (*b == ' ' || *b == '\t' || *b == '\r'))
+		++b;
+	return b == e;
+}
+
+// a line of just the atom number
+static inline bool IsCountLine(const char * b, const char * e, const int & nAtom)
+{
+	char * stop;
+	const long n = strtol(b, &stop, 10);
+	return stop != b && n == nAtom && IsBlankLine(stop, e);
+}
+
+bool XyzReader::SkipBlankLines()
+{
+	const char * b;
+	const char * e;
+	while (ReadLine(b, e)) {
+		if (!IsBlankLine(b, e)) {
+			// unread the line, it is still in buffer
+			beg = b - buf.data();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool XyzReader::SeekFrame(const long long & offset, const int & nAtom)
+{
+	const char * b;
+	const char * e;
+
+	// to the first line starting at or after offset
+	if (!Seek(offset > 0 ? offset - 1 : 0))
+		return false;
+	if (offset > 0 && !ReadLine(b, e))
+		return false;
+
+	for (;;) {
+		const long long pos = Offset();
+		if (!ReadLine(b, e))
+			return false;
+		const long long next = Offset();
+		if (!IsCountLine(b, e, nAtom))
+			continue;
+
+		// confirm by the next frame
+		bool ok = true;
+		if (SkipLines(nAtom + 1LL) && SkipBlankLines()) {
+			ReadLine(b, e);
+			ok = IsCountLine(b, e, nAtom);
+		}
+
+		if (ok)
+			return Seek(pos);
+		Seek(next);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef XYZREADER_H_
+#define XYZREADER_H_
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+// buffered line reader of xyz trajectory on a file descriptor
+// lines are returned as [b, e) pointing into the buffer, valid until the next call,
+// the byte at e is always '\n' or '\0', so strtod / strtol stop at the end of line
+class XyzReader
+{
+	int fd;
+	bool ownFd;
+	bool ifEof;
+	std::vector<char> buf;
+	// unread data is buf[beg, end)
+	size_t beg;
+	size_t end;
+	// file offset of buf[0]
+	long long bufOffset;
+
+public:
+	XyzReader();
+	~XyzReader();
+
+	// open file, return false if failed
+	bool Open(const string & file);
+	// read from an opened descriptor, e.g. 0 for stdin
+	void OpenFd(const int & _fd);
+	// read from a copy of data in memory
+	void OpenMemory(const char * data, const size_t & size);
+	void Close();
+
+	// read one line without '\n', return false at end of input
+	bool ReadLine(const char *& b, const char *& e);
+	// read the atom number line of next frame, skipping blank lines, return false at end of input
+	bool ReadCount(int & count);
+	// skip n lines without parsing, return false if input ends first
+	bool SkipLines(long long n);
+	// skip blank lines before a frame, return false at end of input
+	bool SkipBlankLines();
+	// move to the first frame whose atom number line starts at or after offset, only for regular files;
+	// a line holding just nAtom starts a frame if the line nAtom + 2 lines later starts one too, or input ends
+	// return false if there is no such frame
+	bool SeekFrame(const long long & offset, const int & nAtom);
+
+	// offset of next unread byte
+	inline long long Offset() const { return bufOffset + static_cast<long long>(beg); }
+	// move to offset, only for regular files
+	bool Seek(const long long & offset);
+
+private:
+	// read more data into buffer, keeping buf[beg, end), return false if nothing read
+	bool Fill();
+};
+
+#endif // !XYZREADER_H_
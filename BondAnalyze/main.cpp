@@ -3,39 +3,535 @@
 #include <sstream>
 #include <iomanip>
 #include <cstdlib>
+#include <cstdio>
+#include <cmath>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <getopt.h>
 #include <memory>
 #include <algorithm>
-#include "Molecule.h"
-#include "FinderAtom.h"
-#include "FinderBond.h"
-
-constexpr int BLANK = 2;
-constexpr int DATAWIDTH = 15;
-constexpr int DATAPRECISION = 6;
+#include <iterator>
+#include "Analyzer.h"
+#include "Checkpoint.h"
+#include "XyzReader.h"
+#include "AllocCount.h"
+#include "TextOutput.h"
+#include "Server.h"
+#include "Fanout.h"
+#include "Telemetry.h"
+#include "Packed.h"
+#include "FrameFilter.h"
+#include "ResultCache.h"
+#include "Composition.h"
+#include "ShmRing.h"
 
 using namespace std;
 
-ofstream debug;
+// output file of input file: the extension replaced by ext
+static string OutputName(const string & in_file, const string & ext = ".anly")
+{
+	string out_file = in_file;
 
-int main(int argc, char **argv)
+	const auto pos = out_file.rfind('.');
+	if (pos < out_file.size()) {
+		out_file.replace(pos, out_file.size() - pos, ext);
+	}
+	else {
+		out_file.append(ext);
+	}
+	return out_file;
+}
+
+// --connect: send the analysis to the server, write the reply as a local run would
+static int Connect(const string & socket_path, const string & cfg_text, int argc, char **argv,
+	bool opt_r, bool opt_f, bool opt_h, bool opt_e, long long opt_stride, long long opt_start, long long opt_stop, bool ifFile,
+	const string & opt_where)
+{
+	Message req;
+	req["cfg"] = cfg_text;
+	req["flags"] = string(opt_f ? "f" : "") + (opt_h ? "h" : "") + (opt_e ? "e" : "");
+	req["stride"] = to_string(opt_stride);
+	req["start"] = to_string(opt_start);
+	req["stop"] = to_string(opt_stop);
+	req["where"] = opt_where;
+
+	if (opt_f) {
+		req["rule"] = argv[optind];
+	}
+	else if (opt_r) {
+		if (argc - optind < 1) {
+			cerr << "BondAnalyze: missing operand" << endl;
+			exit(1);
+		}
+
+		ifstream fin(argv[optind], ifstream::in);
+		if (!fin) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "rule file open failed!" << endl;
+			exit(1);
+		}
+		req["rules"].assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+	}
+
+	string in_file;
+	if (ifFile) {
+		in_file = argv[argc - 1];
+		ifstream fin(in_file.c_str(), ifstream::in | ifstream::binary);
+		if (!fin) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "input file " << in_file << " open failed!" << endl;
+			exit(1);
+		}
+		req["data"].assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+	}
+	else {
+		req["data"].assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+	}
+
+	Message reply;
+	if (!Request(socket_path, req, reply)) {
+		cerr << "BondAnalyze: connect to " << socket_path << " failed" << endl;
+		return 1;
+	}
+	if (reply["status"] != "ok") {
+		cerr << "BondAnalyze: " << reply["error"] << endl;
+		return 1;
+	}
+
+	if (ifFile) {
+		ofstream fout(OutputName(in_file).c_str(), ofstream::out | ofstream::binary);
+		fout << reply["anly"];
+	}
+	else {
+		cout << reply["anly"];
+	}
+	return 0;
+}
+
+// --output: write all outputs in a single pass over input file, or stdin if nullptr
+static int RunFanout(const vector<string> & spec, const char * in_file, long long opt_stride, long long opt_start, long long opt_stop,
+	const FrameFilter & filter, Telemetry & telemetry)
+{
+	Fanout fanout;
+	for (const auto & s : spec) {
+		string error;
+		if (!fanout.Add(s, error)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << error << endl;
+			exit(1);
+		}
+	}
+	fanout.Compile();
+
+	XyzReader reader;
+	if (in_file) {
+		if (!reader.Open(in_file)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "input file " << in_file << " open failed!" << endl;
+			exit(1);
+		}
+	}
+	else {
+		reader.OpenFd(STDIN_FILENO);
+	}
+
+	if (opt_stride < 1)
+		opt_stride = 1;
+
+	long long frame = 0;
+	int tmp;
+	while ((opt_stop < 0 || frame < opt_stop) && reader.ReadCount(tmp)) {
+		if (frame < opt_start || (frame - opt_start) % opt_stride != 0) {
+			if (!reader.SkipLines(tmp + 1LL))
+				break;
+			frame++;
+			continue;
+		}
+
+		Telemetry::Clock::time_point t;
+		if (telemetry.ifEnabled())
+			t = Telemetry::Clock::now();
+
+		bool ifPass;
+		if (!fanout.ReadFrame(reader, filter, ifPass))
+			break;
+		if (telemetry.ifEnabled())
+			t = telemetry.Lap(Telemetry::READ, t);
+		if (!ifPass) {
+			frame++;
+			continue;
+		}
+
+		fanout.Write(frame);
+		frame++;
+
+		if (telemetry.ifEnabled()) {
+			telemetry.Lap(Telemetry::WRITE, t);
+			telemetry.frames++;
+			telemetry.bytesRead = reader.Offset();
+		}
+	}
+
+	reader.Close();
+	fanout.Close();
+	telemetry.Stop();
+	return 0;
+}
+
+// --attach: follow the shared memory ring of an output of format shm, write its rows as text to stdout
+static int Attach(const string & shm_name)
+{
+	ShmRing ring;
+	string error;
+	if (!ring.Attach(shm_name, error)) {
+		cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+		cerr << error << endl;
+		exit(1);
+	}
+
+	vector<string> name = ring.ColName();
+	name.push_back("Energy");
+	TextOutput text(cout, true, false);
+	text.WriteHeader(name);
+
+	const int nCol = ring.ColNum();
+	vector<double> row(nCol + 1);
+	uint64_t n = 0;
+	while (true) {
+		const bool ifClosed = ring.ifClosed();
+		const uint64_t published = ring.Published();
+		if (n >= published) {
+			if (ifClosed)
+				break;
+			usleep(1000);
+			continue;
+		}
+
+		long long frame;
+		double energy;
+		const double * value = ring.Row(n, frame, energy);
+		if (value) {
+			copy(value, value + nCol, row.begin());
+			row[nCol] = energy;
+		}
+		if (!value || !ring.Check(n)) {
+			// overwritten by the producer: skip to the oldest row still in the ring
+			const uint64_t oldest = ring.Published() - ring.SlotNum();
+			if (oldest > n) {
+				cerr << "BondAnalyze: rows " << n << " to " << oldest - 1 << " lost" << endl;
+				n = oldest;
+			}
+			continue;
+		}
+		text.WriteRow(row.data(), nCol + 1, 0.0);
+		n++;
+	}
+	cout.flush();
+	return 0;
+}
+
+// --mixed: analyze frames of varying molecules, each with the rules compiled for its composition
+static int RunMixed(const string & rules, const bool & ifLine, const char * in_file, const size_t & maxSlot,
+	const bool & ifHeader, const bool & ifEnergy, long long opt_stride, long long opt_start, long long opt_stop,
+	const FrameFilter & filter)
+{
+	CompositionCache composition(rules, ifLine, maxSlot);
+
+	XyzReader reader;
+	ofstream fout;
+	if (in_file) {
+		if (!reader.Open(in_file)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "input file " << in_file << " open failed!" << endl;
+			exit(1);
+		}
+		fout.open(OutputName(in_file).c_str(), ofstream::out);
+	}
+	else {
+		reader.OpenFd(STDIN_FILENO);
+	}
+	ostream & out = in_file ? fout : cout;
+	TextOutput text(out, ifHeader, ifEnergy);
+
+	// the columns are the rules, the same for all compositions; the header waits for the first Analyzer
+	bool ifFirst = true;
+	vector<double> row;
+	long long frame = 0;
+	int count;
+	while ((opt_stop < 0 || frame < opt_stop) && reader.ReadCount(count)) {
+		if (frame < opt_start || (frame - opt_start) % opt_stride != 0) {
+			if (!reader.SkipLines(count + 1LL))
+				break;
+			frame++;
+			continue;
+		}
+
+		bool ifPass;
+		string warning;
+		string error;
+		if (!composition.ReadFrame(reader, count, filter, ifPass, warning, error)) {
+			if (!error.empty()) {
+				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+				cerr << "frame " << frame << ": " << error << endl;
+				exit(1);
+			}
+			break;
+		}
+		if (!warning.empty())
+			cerr << "BondAnalyze: frame " << frame << ": " << warning << endl;
+		frame++;
+		if (!ifPass)
+			continue;
+
+		Analyzer & analyzer = composition.refAnalyzer();
+		if (ifFirst) {
+			text.WriteHeader(analyzer);
+			row.resize(analyzer.ColNum());
+			ifFirst = false;
+		}
+		analyzer.Analyze(row.data());
+		text.WriteRow(row.data(), analyzer.ColNum(), analyzer.Energy());
+	}
+
+	reader.Close();
+	out.flush();
+	if (in_file)
+		fout.close();
+	return 0;
+}
+
+// --shards: analyze shard i of nShard byte ranges of in_file into part_file
+// the shard holds the frames starting in its range; with sampling, the frames before it are
+// counted by the other shards: this one sends its frame count up and gets its first frame index down
+static int RunShard(Analyzer & analyzer, const string & in_file, const string & part_file, const int & i, const int & nShard,
+	const bool & ifHeader, const bool & ifEnergy, long long opt_stride, long long opt_start, long long opt_stop,
+	const FrameFilter & filter, const int & up, const int & down)
 {
+	struct stat st;
+	if (stat(in_file.c_str(), &st) != 0)
+		return 1;
+	const long long size = st.st_size;
+
+	XyzReader reader;
+	long long endOffset = size;
+	if (i + 1 < nShard) {
+		if (!reader.Open(in_file))
+			return 1;
+		if (reader.SeekFrame(size * (i + 1) / nShard, Molecule::totAtom))
+			endOffset = reader.Offset();
+	}
+
+	if (!reader.Open(in_file))
+		return 1;
+	long long beginOffset = size;
+	if (reader.SeekFrame(size * i / nShard, Molecule::totAtom))
+		beginOffset = reader.Offset();
+
+	const bool ifSample = !(opt_stride == 1 && opt_start == 0 && opt_stop < 0);
+	long long frame = 0;
+	int tmp;
+	if (ifSample) {
+		long long count = 0;
+		reader.Seek(beginOffset);
+		while (reader.SkipBlankLines() && reader.Offset() < endOffset && reader.ReadCount(tmp) && reader.SkipLines(tmp + 1LL))
+			count++;
+		if (write(up, &count, sizeof(count)) != sizeof(count) || read(down, &frame, sizeof(frame)) != sizeof(frame))
+			return 1;
+	}
+	reader.Seek(beginOffset);
+
+	ofstream fout(part_file.c_str(), ofstream::out);
+	TextOutput text(fout, ifHeader, ifEnergy);
+	if (i == 0)
+		text.WriteHeader(analyzer);
+
+	vector<double> row(analyzer.ColNum());
+	while ((opt_stop < 0 || frame < opt_stop) && reader.SkipBlankLines() && reader.Offset() < endOffset && reader.ReadCount(tmp)) {
+		if (frame < opt_start || (frame - opt_start) % opt_stride != 0) {
+			if (!reader.SkipLines(tmp + 1LL))
+				break;
+			frame++;
+			continue;
+		}
+
+		bool ifPass;
+		if (!analyzer.ReadFrame(reader, filter, ifPass))
+			break;
+		if (ifPass) {
+			analyzer.Analyze(row.data());
+			text.WriteRow(row.data(), analyzer.ColNum(), analyzer.Energy());
+		}
+		frame++;
+	}
+
+	fout.close();
+	return fout ? 0 : 1;
+}
+
+// --shards: analyze nShard byte ranges of in_file in parallel processes, then join their outputs in order
+static int RunShards(Analyzer & analyzer, const string & in_file, const string & out_file, const int & nShard,
+	const bool & ifHeader, const bool & ifEnergy, long long opt_stride, long long opt_start, long long opt_stop,
+	const FrameFilter & filter)
+{
+	vector<pid_t> pid(nShard);
+	vector<int> up(nShard);
+	vector<int> down(nShard);
+	vector<string> part_file(nShard);
+
+	cout.flush();
 #ifdef DEBUG_MOLECULE
-	debug.open("debug.txt", ofstream::out);
+	debug.flush();
 #endif // DEBUG_MOLECULE
 
+	for (int i = 0; i < nShard; ++i) {
+		part_file[i] = out_file + ".shard" + to_string(i);
+
+		int upPipe[2];
+		int downPipe[2];
+		if (pipe(upPipe) != 0 || pipe(downPipe) != 0) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "pipe failed!" << endl;
+			exit(1);
+		}
+
+		pid[i] = fork();
+		if (pid[i] == 0) {
+			close(upPipe[0]);
+			close(downPipe[1]);
+			_exit(RunShard(analyzer, in_file, part_file[i], i, nShard, ifHeader, ifEnergy,
+				opt_stride, opt_start, opt_stop, filter, upPipe[1], downPipe[0]));
+		}
+		close(upPipe[1]);
+		close(downPipe[0]);
+		up[i] = upPipe[0];
+		down[i] = downPipe[1];
+	}
+
+	// first frame index of each shard
+	const bool ifSample = !(opt_stride == 1 && opt_start == 0 && opt_stop < 0);
+	if (ifSample) {
+		long long frame = 0;
+		for (int i = 0; i < nShard; ++i) {
+			long long count = 0;
+			if (read(up[i], &count, sizeof(count)) != sizeof(count))
+				count = 0;
+			if (write(down[i], &frame, sizeof(frame)) != sizeof(frame))
+				break;
+			frame += count;
+		}
+	}
+
+	int status = 0;
+	for (int i = 0; i < nShard; ++i) {
+		close(up[i]);
+		close(down[i]);
+
+		int wstatus;
+		if (waitpid(pid[i], &wstatus, 0) != pid[i] || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+			status = 1;
+	}
+
+	if (status == 0) {
+		ofstream fout(out_file.c_str(), ofstream::out | ofstream::binary);
+		for (const auto & part : part_file) {
+			ifstream fin(part.c_str(), ifstream::in | ifstream::binary);
+			if (fin.peek() != ifstream::traits_type::eof())
+				fout << fin.rdbuf();
+		}
+		if (!fout.flush())
+			status = 1;
+	}
+	for (const auto & part : part_file)
+		remove(part.c_str());
+
+	if (status != 0) {
+		cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+		cerr << "a shard of " << in_file << " failed!" << endl;
+	}
+	return status;
+}
+
+// --self-check: analyze synthetic frames of water boxes with every kind of rule and with the full dump,
+// fail if a frame after warm-up allocates on the heap; run after every build, see BondAnalyze.vcxproj
+static int SelfCheck()
+{
+	constexpr int nSide = 3;
+	constexpr int nWater = nSide * nSide * nSide;
+	constexpr long long WARMUP = 2;
+	constexpr long long nFrame = 8;
+
+	ostringstream cfg;
+	cfg << "molecule = check\nelem_num = 2\nelem_list = (O H)\natom_num = " << 3 * nWater << "\natom_list = (";
+	for (int i = 0; i < nWater; ++i)
+		cfg << (i ? " " : "") << "O H H";
+	cfg << ")\n";
 	{
-		ifstream cfg;
-		string sys_name = getenv("MOLECULE");
-		string cfg_file = getenv("MOLECULE_DIR");
-		cfg_file += "/." + sys_name;
+		istringstream sin(cfg.str());
+		Analyzer::LoadSchema(sin);
+	}
 
-		cfg.open(cfg_file.c_str(), ifstream::in);
+	// empty for the full dump
+	const char * rule_set[] = {
+		"",
+		"bond O H min 1\n"
+		"bond O H max 2\n"
+		"bond H H min 3\n"
+		"track O H min 4\n"
+		"atom O O H min 1 H O H min 2\n"
+		"angle H O H min 1 O O H min 1 H O H min 2\n"
+		"dihedral H O H min 1 O O H min 1 O O H min 2 H O H min 2\n"
+		"coord O O H min 1 H 1.5\n"
+		"contactmap O H 2.0\n"
+	};
 
-		Molecule::usingBond();
-		Molecule::InputInfo(cfg);
-		cfg.close();
+	int status = 0;
+	vector<double> x(3 * 3 * nWater);
+	for (const char * rules : rule_set) {
+		Analyzer analyzer;
+		istringstream rin(rules);
+		string bad_line;
+		if (!analyzer.AddRules(rin, &bad_line)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "invalid rule: " << bad_line << " (" << analyzer.RuleError() << ")" << endl;
+			exit(1);
+		}
+		analyzer.Compile();
+		vector<double> row(analyzer.ColNum());
+
+		long long nAlloc = 0;
+		for (long long frame = 0; frame < WARMUP + nFrame; ++frame) {
+			// waters 3 A apart on a cubic grid, moving a little each frame
+			for (int i = 0; i < nWater; ++i) {
+				const double o[3] = { 3.0 * (i % nSide), 3.0 * (i / nSide % nSide), 3.0 * (i / nSide / nSide) };
+				for (int j = 0; j < 3; ++j) {
+					const double shake = 0.1 * std::sin(0.7 * frame + 1.3 * i + 2.1 * j);
+					x[9 * i + j] = o[j] + shake;
+					x[9 * i + 3 + j] = o[j] + shake + (j == 0 ? 0.96 : 0.0);
+					x[9 * i + 6 + j] = o[j] - shake + (j == 1 ? 0.96 : 0.0);
+				}
+			}
+
+			const long long allocBegin = AllocCount();
+			analyzer.LoadFrame(x.data(), -76.0 * nWater);
+			analyzer.Analyze(row.data());
+			if (frame >= WARMUP)
+				nAlloc += AllocCount() - allocBegin;
+		}
+
+		cerr << "BondAnalyze: " << (rules[0] ? "rules" : "dump") << ": " << nAlloc
+			<< " heap allocations in " << nFrame << " frames after warm-up" << endl;
+		if (nAlloc != 0)
+			status = 1;
 	}
+	return status;
+}
+
+int main(int argc, char **argv)
+{
+#ifdef DEBUG_MOLECULE
+	debug.open("debug.txt", ofstream::out);
+#endif // DEBUG_MOLECULE
 
 	// -r: find bond length according to rule file
 	bool opt_r = false;
@@ -45,10 +541,98 @@ int main(int argc, char **argv)
 	bool opt_e = false;
 	// -f: find bond length according to one rule line
 	bool opt_f = false;	
+	// --checkpoint N: save a checkpoint every N analyzed frames (file input only)
+	long long opt_checkpoint = 0;
+	// --resume: continue from the checkpoint of the output file
+	bool opt_resume = false;
+	// --stride N: analyze every N-th frame
+	long long opt_stride = 1;
+	// --start N: first frame to analyze, counted from 0
+	long long opt_start = 0;
+	// --stop N: stop before frame N, -1 for the end of input
+	long long opt_stop = -1;
+	// --alloc-check: report heap allocations of steady frames, exit with 1 if any
+	bool opt_alloc_check = false;
+	// --self-check: --alloc-check on synthetic frames, without input or molecule description
+	bool opt_self_check = false;
+	// --serve SOCKET: serve analyses on a unix socket
+	string opt_serve;
+	// --workers N: number of worker processes of --serve, default one per cpu
+	int opt_workers = 0;
+	// --connect SOCKET: send the analysis to a server instead of running it
+	string opt_connect;
+	// --output SPEC: one of several outputs written in a single pass, see Output.h
+	vector<string> opt_output;
+	// --threads N: threads of a big frame, 0 (default) for one per cpu, 1 for serial
+	int opt_threads = 0;
+	// --metrics FILE: write counters of the run to FILE in Prometheus text format
+	string opt_metrics;
+	// --status: show counters of the run as a status line on stderr
+	bool opt_status = false;
+	// --metrics-interval S: seconds between writes of --metrics / --status
+	double opt_metrics_interval = 5.0;
+	// --packed TOL: write packed output (see Packed.h) of tolerance TOL to <in>.bapk instead of text
+	double opt_packed = 0.0;
+	// --decode: decode the packed output file operand to text on stdout
+	bool opt_decode = false;
+	// --attach NAME: write the rows of the shared memory ring NAME (output format shm) as text on stdout
+	string opt_attach;
+	// --emin E, --emax E, --where EXPR: analyze only frames whose comment line passes, see FrameFilter.h
+	string opt_where;
+	// --shards N: analyze N byte ranges of the input file in parallel processes
+	int opt_shards = 1;
+	// --stream: calculate bonds tile by tile, keeping only the ranks the rules read (see Molecule::usingStream)
+	bool opt_stream = false;
+	// --mixed: frames of varying molecules, the atom list of each frame read from its atom lines, see Composition.h
+	bool opt_mixed = false;
+	// --mixed-cache N: compositions kept compiled by --mixed
+	int opt_mixed_cache = 64;
+	// --squared: rank bonds by squared length, see Molecule::usingSquared
+	bool opt_squared = false;
+	// --cache DIR: reuse the output of a run with the same input, config, rules and options, see ResultCache.h
+	string opt_cache;
+	// --cache-size MB: cap of the cache, least recently used outputs are removed beyond it
+	long long opt_cache_size = 1024;
+	// --cache-full-hash: identify the input file by all of its bytes instead of size, mtime and samples
+	bool opt_cache_full = false;
 
 	{
-		char cmd;
-		while ((cmd = getopt(argc, argv, "rfhe")) != -1) {
+		enum { OPT_CHECKPOINT = 256, OPT_RESUME, OPT_STRIDE, OPT_START, OPT_STOP, OPT_ALLOC_CHECK, OPT_SERVE, OPT_WORKERS, OPT_CONNECT, OPT_OUTPUT, OPT_THREADS, OPT_METRICS, OPT_STATUS, OPT_METRICS_INTERVAL, OPT_PACKED, OPT_DECODE, OPT_EMIN, OPT_EMAX, OPT_WHERE, OPT_SHARDS, OPT_STREAM, OPT_CACHE, OPT_CACHE_SIZE, OPT_CACHE_FULL, OPT_SQUARED, OPT_MIXED, OPT_MIXED_CACHE, OPT_ATTACH, OPT_SELF_CHECK };
+		static const option long_opts[] = {
+			{ "checkpoint", required_argument, nullptr, OPT_CHECKPOINT },
+			{ "resume", no_argument, nullptr, OPT_RESUME },
+			{ "stride", required_argument, nullptr, OPT_STRIDE },
+			{ "start", required_argument, nullptr, OPT_START },
+			{ "stop", required_argument, nullptr, OPT_STOP },
+			{ "alloc-check", no_argument, nullptr, OPT_ALLOC_CHECK },
+			{ "self-check", no_argument, nullptr, OPT_SELF_CHECK },
+			{ "serve", required_argument, nullptr, OPT_SERVE },
+			{ "workers", required_argument, nullptr, OPT_WORKERS },
+			{ "connect", required_argument, nullptr, OPT_CONNECT },
+			{ "output", required_argument, nullptr, OPT_OUTPUT },
+			{ "threads", required_argument, nullptr, OPT_THREADS },
+			{ "metrics", required_argument, nullptr, OPT_METRICS },
+			{ "status", no_argument, nullptr, OPT_STATUS },
+			{ "metrics-interval", required_argument, nullptr, OPT_METRICS_INTERVAL },
+			{ "packed", required_argument, nullptr, OPT_PACKED },
+			{ "decode", no_argument, nullptr, OPT_DECODE },
+			{ "attach", required_argument, nullptr, OPT_ATTACH },
+			{ "emin", required_argument, nullptr, OPT_EMIN },
+			{ "emax", required_argument, nullptr, OPT_EMAX },
+			{ "where", required_argument, nullptr, OPT_WHERE },
+			{ "shards", required_argument, nullptr, OPT_SHARDS },
+			{ "stream", no_argument, nullptr, OPT_STREAM },
+			{ "cache", required_argument, nullptr, OPT_CACHE },
+			{ "cache-size", required_argument, nullptr, OPT_CACHE_SIZE },
+			{ "cache-full-hash", no_argument, nullptr, OPT_CACHE_FULL },
+			{ "squared", no_argument, nullptr, OPT_SQUARED },
+			{ "mixed", no_argument, nullptr, OPT_MIXED },
+			{ "mixed-cache", required_argument, nullptr, OPT_MIXED_CACHE },
+			{ nullptr, 0, nullptr, 0 }
+		};
+
+		int cmd;
+		while ((cmd = getopt_long(argc, argv, "rfhe", long_opts, nullptr)) != -1) {
 			switch (cmd)
 			{
 			case 'r':
@@ -63,78 +647,209 @@ int main(int argc, char **argv)
 			case 'e':
 				opt_e = true;
 				break;
+			case OPT_CHECKPOINT:
+				opt_checkpoint = atoll(optarg);
+				break;
+			case OPT_RESUME:
+				opt_resume = true;
+				break;
+			case OPT_STRIDE:
+				opt_stride = atoll(optarg);
+				break;
+			case OPT_START:
+				opt_start = atoll(optarg);
+				break;
+			case OPT_STOP:
+				opt_stop = atoll(optarg);
+				break;
+			case OPT_ALLOC_CHECK:
+				opt_alloc_check = true;
+				break;
+			case OPT_SELF_CHECK:
+				opt_self_check = true;
+				break;
+			case OPT_SERVE:
+				opt_serve = optarg;
+				break;
+			case OPT_WORKERS:
+				opt_workers = atoi(optarg);
+				break;
+			case OPT_CONNECT:
+				opt_connect = optarg;
+				break;
+			case OPT_OUTPUT:
+				opt_output.push_back(optarg);
+				break;
+			case OPT_THREADS:
+				opt_threads = atoi(optarg);
+				break;
+			case OPT_METRICS:
+				opt_metrics = optarg;
+				break;
+			case OPT_STATUS:
+				opt_status = true;
+				break;
+			case OPT_METRICS_INTERVAL:
+				opt_metrics_interval = atof(optarg);
+				break;
+			case OPT_PACKED:
+				opt_packed = atof(optarg);
+				break;
+			case OPT_DECODE:
+				opt_decode = true;
+				break;
+			case OPT_ATTACH:
+				opt_attach = optarg;
+				break;
+			case OPT_EMIN:
+				opt_where += string(",$1>=") + optarg;
+				break;
+			case OPT_EMAX:
+				opt_where += string(",$1<=") + optarg;
+				break;
+			case OPT_WHERE:
+				opt_where += string(",") + optarg;
+				break;
+			case OPT_SHARDS:
+				opt_shards = atoi(optarg);
+				break;
+			case OPT_STREAM:
+				opt_stream = true;
+				break;
+			case OPT_CACHE:
+				opt_cache = optarg;
+				break;
+			case OPT_CACHE_SIZE:
+				opt_cache_size = atoll(optarg);
+				break;
+			case OPT_CACHE_FULL:
+				opt_cache_full = true;
+				break;
+			case OPT_SQUARED:
+				opt_squared = true;
+				break;
+			case OPT_MIXED:
+				opt_mixed = true;
+				break;
+			case OPT_MIXED_CACHE:
+				opt_mixed_cache = atoi(optarg);
+				break;
 			}
 		}
 	}
 
-	vector<shared_ptr<FinderBase>> rule;
-	if (opt_f) {
+	Molecule::usingThreads(opt_threads);
+	if (opt_stream)
+		Molecule::usingStream();
+	if (opt_squared)
+		Molecule::usingSquared();
 
-		Molecule::usingMatrixR();
+	FrameFilter filter;
+	{
+		string error;
+		if (!filter.Add(opt_where, error)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << error << endl;
+			exit(1);
+		}
+	}
 
-		istringstream sin;
-		sin.str(argv[optind]);
+	if (!opt_attach.empty())
+		return Attach(opt_attach);
 
-		string var;
-		sin >> var;
-		if (var == "bond") {
-			string iE, jE, sort_type;
-			int num;
+	if (opt_self_check)
+		return SelfCheck();
 
-			sin >> iE >> jE >> sort_type >> num;
-			if (sin)
-				rule.emplace_back(new FinderBond(iE, jE, sort_type, num));
-			else {
-				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "invalid rule" << endl;
-				exit(1);
-			}
+	if (opt_decode) {
+		ifstream fin;
+		if (argc - optind > 0)
+			fin.open(argv[optind], ifstream::in | ifstream::binary);
+		if (!fin || !DecodePacked(fin, cout)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "packed file open failed!" << endl;
+			exit(1);
 		}
-		else if (var == "atom") {
-			string aE, aiE, ajE, aSortType;
-			string bE, biE, bjE, bSortType;
-			int aNum, bNum;
+		return 0;
+	}
 
-			sin >> aE >> aiE >> ajE >> aSortType >> aNum;
-			sin >> bE >> biE >> bjE >> bSortType >> bNum;
+	if (!opt_serve.empty()) {
+		if (opt_workers < 1)
+			opt_workers = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+		return Serve(opt_serve, opt_workers);
+	}
 
-			if (aiE == ajE) {
-				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "aiE == ajE" << endl;
-				exit(1);
-			}
-			else if (aE != aiE && aE != ajE) {
-				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "aE != aiE && aE != ajE" << endl;
-				exit(1);
-			}
+	string cfg_text;
+	{
+		ifstream cfg;
+		string sys_name = getenv("MOLECULE");
+		string cfg_file = getenv("MOLECULE_DIR");
+		cfg_file += "/." + sys_name;
 
-			if (biE == bjE) {
-				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "biE == bjE" << endl;
-				exit(1);
-			}
-			else if (bE != biE && bE != bjE) {
-				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "bE != biE && bE != bjE" << endl;
-				exit(1);
-			}
+		cfg.open(cfg_file.c_str(), ifstream::in);
+		cfg_text.assign(istreambuf_iterator<char>(cfg), istreambuf_iterator<char>());
+		cfg.close();
+	}
+
+	const bool ifFile = (opt_r || opt_f) && (argc - optind > 1) || !(opt_r || opt_f) && (argc - optind > 0);
+
+	if (!opt_connect.empty()) {
+		return Connect(opt_connect, cfg_text, argc, argv, opt_r, opt_f, opt_h, opt_e, opt_stride, opt_start, opt_stop, ifFile, opt_where);
+	}
+
+	{
+		istringstream cfg(cfg_text);
+		Analyzer::LoadSchema(cfg);
+	}
+
+	if (!opt_output.empty()) {
+		// outputs of mode stats / quantile / acf / spectrum accumulate over all frames, a checkpoint can't resume them
+		if (opt_checkpoint > 0 || opt_resume) {
+			cerr << "BondAnalyze: checkpoints are not supported with --output" << endl;
+			exit(1);
+		}
+		if (opt_r || opt_f || opt_h || opt_e || opt_mixed || opt_packed > 0 || !opt_cache.empty() || opt_shards > 1)
+			cerr << "BondAnalyze: -r, -f, -h, -e, --mixed, --packed, --cache and --shards are ignored with --output" << endl;
+		Telemetry telemetry;
+		if (!opt_metrics.empty() || opt_status)
+			telemetry.Start(opt_metrics, opt_status, opt_metrics_interval);
+		return RunFanout(opt_output, argc - optind > 0 ? argv[argc - 1] : nullptr, opt_stride, opt_start, opt_stop, filter, telemetry);
+	}
 
-			if (sin)
-				rule.emplace_back(new FinderAtom(aE, aiE, ajE, aSortType, aNum, bE, biE, bjE, bSortType, bNum));
-			else {
+	if (opt_mixed) {
+		if (opt_packed > 0 || !opt_cache.empty() || opt_shards > 1 || opt_checkpoint > 0 || opt_resume)
+			cerr << "BondAnalyze: --packed, --cache, --shards and checkpoints are ignored with --mixed" << endl;
+		string rules;
+		if (opt_f) {
+			rules = argv[optind];
+		}
+		else if (opt_r && argc - optind > 0) {
+			ifstream fin(argv[optind], ifstream::in);
+			if (!fin) {
 				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-				cerr << "invalid rule" << endl;
+				cerr << "rule file open failed!" << endl;
 				exit(1);
 			}
+			rules.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
 		}
 		else {
-			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-			cerr << "invalid rule" << endl;
+			cerr << "BondAnalyze: --mixed needs rules (-r or -f), the full dump differs by composition" << endl;
 			exit(1);
 		}
 
+		if (opt_stride < 1)
+			opt_stride = 1;
+		return RunMixed(rules, opt_f, ifFile ? argv[argc - 1] : nullptr, opt_mixed_cache,
+			opt_f ? opt_h : !opt_h, opt_f ? opt_e : !opt_e, opt_stride, opt_start, opt_stop, filter);
+	}
+
+	Analyzer analyzer;
+	if (opt_f) {
 
+		if (!analyzer.AddRule(argv[optind])) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "invalid rule: " << argv[optind] << " (" << analyzer.RuleError() << ")" << endl;
+			exit(1);
+		}
 	}
 	else if (opt_r) {
 
@@ -143,8 +858,6 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 
-		Molecule::usingMatrixR();
-
 		ifstream fin;
 		fin.open(argv[optind], ifstream::in);
 		if (!fin) {
@@ -153,280 +866,242 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 
-		while (fin) {
-			int pk = fin.peek();
-			if (pk == '#' || pk == '\n' || pk == ' ' || pk == '\r')
-				fin.ignore(1024, '\n');
-
-			string var;
-			fin >> var;
-			if (var == "bond") {
-				string iE, jE, sort_type;
-				int num;
-
-				fin >> iE >> jE >> sort_type >> num;
-				rule.emplace_back(new FinderBond(iE, jE, sort_type, num));
-			}
-			else if (var == "atom") {
-				string aE, aiE, ajE, aSortType;
-				string bE, biE, bjE, bSortType;
-				int aNum, bNum;
-
-				fin >> aE >> aiE >> ajE >> aSortType >> aNum;
-				fin >> bE >> biE >> bjE >> bSortType >> bNum;
-
-				if (aiE == ajE) {
-					cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-					cerr << "aiE == ajE" << endl;
-					exit(1);
-				}
-				else if (aE != aiE && aE != ajE) {
-					cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-					cerr << "aE != aiE && aE != ajE" << endl;
-					exit(1);
-				}
-
-				if (biE == bjE) {
-					cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-					cerr << "biE == bjE" << endl;
-					exit(1);
-				}
-				else if (bE != biE && bE != bjE) {
-					cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
-					cerr << "bE != biE && bE != bjE" << endl;
-					exit(1);
-				}
-
-				rule.emplace_back(new FinderAtom(aE, aiE, ajE, aSortType, aNum, bE, biE, bjE, bSortType, bNum));
-			}
+		string line;
+		if (!analyzer.AddRules(fin, &line)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "invalid rule: " << line << " (" << analyzer.RuleError() << ")" << endl;
+			exit(1);
 		}
 		fin.close();
 	}
-	else {
 
+	analyzer.Compile();
+	vector<double> row(analyzer.ColNum());
+
+	string in_file;
+	string out_file;
+	string ckpt_file;
+	XyzReader reader;
+	ofstream fout;
+	ostream * out = &cout;
+	Checkpoint ckpt;
+
+	if (opt_packed > 0 && (opt_checkpoint > 0 || opt_resume)) {
+		cerr << "BondAnalyze: checkpoint is not supported with --packed, ignored" << endl;
+		opt_checkpoint = 0;
+		opt_resume = false;
 	}
 
-	Molecule molc;
+	if (opt_stride < 1)
+		opt_stride = 1;
 
-	if ((opt_r || opt_f) && (argc - optind > 1) || !(opt_r || opt_f) && (argc - optind > 0)) 
-	{
-		string in_file = argv[argc - 1];
-		string out_file = in_file;
-		
-		const auto pos = out_file.rfind('.');
-		if (pos < out_file.size()) {
-			out_file.replace(pos, out_file.size() - pos, ".anly");
+	std::unique_ptr<ResultCache> cache;
+	if (!opt_cache.empty()) {
+		if (!ifFile || opt_checkpoint > 0 || opt_resume || analyzer.ifWriteFile()) {
+			cerr << "BondAnalyze: --cache needs an input file, no checkpoint "
+				"and rules writing no file of their own, not used" << endl;
 		}
 		else {
-			out_file.append(".anly");
-		}
-
-		ifstream fin;
-		ofstream fout;
-
-		fin.open(in_file.c_str(), ifstream::in);		
-		fout.open(out_file.c_str(), ofstream::out);
+			in_file = argv[argc - 1];
+			out_file = OutputName(in_file, opt_packed > 0 ? ".bapk" : ".anly");
 
-		fout << setprecision(DATAPRECISION);
+			// everything but the input file that changes the output
+			ostringstream run;
+			run << "BondAnalyze-cache 1\n" << cfg_text << "\nrules\n" << analyzer.RuleText()
+				<< "header " << (opt_f ? opt_h : !opt_h) << "\nenergy " << (opt_f ? opt_e : !opt_e)
+				<< "\nstride " << opt_stride << "\nstart " << opt_start << "\nstop " << opt_stop
+				<< "\nwhere " << opt_where << "\npacked " << setprecision(17) << opt_packed << '\n';
 
-		if (opt_f) {
-
-			if (opt_h) {
-				fout << setw(BLANK) << left << '#';
-				for (int i = 0; i < rule.size(); ++i) {
-					ostringstream sout;
-					sout << "rule" << i + 1;
-					fout << setw(DATAWIDTH) << left << sout.str();
-				}
-				if (!opt_e)
-					fout << endl;
-				else
-					fout << "Energy" << endl;
-			}
+			cache.reset(new ResultCache(opt_cache, opt_cache_size << 20));
+			if (!cache->Key(in_file, run.str(), opt_cache_full))
+				cache.reset();
+			else if (cache->Fetch(out_file))
+				return 0;
 		}
-		else if (opt_r) {
+	}
 
-			if (!opt_h) {
-				fout << setw(BLANK) << left << '#';
-				for (int i = 0; i < rule.size(); ++i) {
-					ostringstream sout;
-					sout << "rule" << i + 1;
-					fout << setw(DATAWIDTH) << left << sout.str();
-				}
-				if (opt_e)
-					fout << endl;
-				else
-					fout << "Energy" << endl;
-			}
+	if (opt_shards > 1) {
+		// shards start with fresh rule state, so rules carrying state across frames need the serial run
+		if (!ifFile || opt_packed > 0 || opt_checkpoint > 0 || opt_resume || !analyzer.SaveState().empty()) {
+			cerr << "BondAnalyze: --shards needs an input file, text output, no checkpoint "
+				"and rules without state across frames, run serially" << endl;
 		}
 		else {
-
-			if (!opt_h) {
-				fout << setw(BLANK) << left << '#';
-				for (int iBondType = 0; iBondType < Molecule::nBondtype; ++iBondType) {
-					for (int iBond = 0; iBond < Molecule::nBond[iBondType]; ++iBond) {
-						ostringstream sout;
-						sout << Molecule::bondtype_list[iBondType] << '(' << iBond + 1 << ')';
-						fout << setw(DATAWIDTH) << left << sout.str();
-					}
-				}
-				if (opt_e)
-					fout << endl;
-				else
-					fout << "Energy" << endl;
-			}
+			in_file = argv[argc - 1];
+			out_file = OutputName(in_file);
+			const int status = RunShards(analyzer, in_file, out_file, opt_shards,
+				opt_f ? opt_h : !opt_h, opt_f ? opt_e : !opt_e, opt_stride, opt_start, opt_stop, filter);
+			if (status == 0 && cache)
+				cache->Store(out_file);
+			return status;
 		}
+	}
 
-		int tmp;
-		while (fin >> tmp) {
-			molc.InputEnergy(fin);
-			molc.InputX(fin);
+	if (ifFile) {
+		in_file = argv[argc - 1];
+		out_file = OutputName(in_file, opt_packed > 0 ? ".bapk" : ".anly");
+		ckpt_file = out_file + ".ckpt";
 
-			if (opt_f) {
-				if (opt_h)
-					fout << setw(BLANK) << left << ' ';
+		if (!reader.Open(in_file)) {
+			cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+			cerr << "input file " << in_file << " open failed!" << endl;
+			exit(1);
+		}
 
-				fout << setw(DATAWIDTH) << left << rule[0]->GetBond(molc);
-				if (opt_e)
-					fout << molc.refEnergy() << endl;
-				else
-					fout << endl;
+		if (opt_resume && ckpt.Load(ckpt_file)) {
+			if (!analyzer.LoadState(ckpt.state)) {
+				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+				cerr << "checkpoint " << ckpt_file << " doesn't match the rules!" << endl;
+				exit(1);
 			}
-			else if (opt_r) {
-				if (!opt_h)
-					fout << setw(BLANK) << left << ' ';
 
-				for (size_t i = 0; i < rule.size(); ++i) {
-					fout << setw(DATAWIDTH) << left << rule[i]->GetBond(molc);
-				}
-				if (opt_e)
-					fout << endl;
-				else
-					fout << molc.refEnergy() << endl;
+			// drop the rows written after the checkpoint; a shorter file lost rows the checkpoint counts
+			struct stat st;
+			if (stat(out_file.c_str(), &st) != 0 || st.st_size < ckpt.outOffset) {
+				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+				cerr << "output file " << out_file << " is shorter than checkpoint " << ckpt_file << "!" << endl;
+				exit(1);
 			}
-			else {
-				if (!opt_h)
-					fout << setw(BLANK) << left << ' ';
-
-				vector<vector<Molecule::Bond>> bond = molc.refBond();
-				for (int iBondtype = 0; iBondtype < Molecule::nBondtype; ++iBondtype) {
-					sort(bond[iBondtype].begin(), bond[iBondtype].end());
-
-					for (int iBond = 0; iBond < Molecule::nBond[iBondtype]; ++iBond) {
-						fout << setw(DATAWIDTH) << left << bond[iBondtype][iBond].getLen();
-					}
-				}
-				if (opt_e)
-					fout << endl;
-				else
-					fout << molc.refEnergy() << endl;
+			if (truncate(out_file.c_str(), ckpt.outOffset) != 0) {
+				cerr << "Error: " << __FILE__ << " : " << __LINE__ << endl;
+				cerr << "output file " << out_file << " truncate failed!" << endl;
+				exit(1);
 			}
+			fout.open(out_file.c_str(), ofstream::out | ofstream::app);
+			reader.Seek(ckpt.inOffset);
 		}
-		fin.close();
-		fout.close();
+		else {
+			if (opt_resume)
+				cerr << "BondAnalyze: no checkpoint " << ckpt_file << ", start from frame 0" << endl;
+			opt_resume = false;
+			fout.open(out_file.c_str(), ofstream::out | (opt_packed > 0 ? ofstream::binary : ofstream::openmode()));
+		}
+
+		out = &fout;
 	}
 	else {
+		reader.OpenFd(STDIN_FILENO);
+	}
 
-	cout << setprecision(DATAPRECISION);
-
-	if (opt_f) {
+	if (!ifFile && (opt_checkpoint > 0 || opt_resume)) {
+		cerr << "BondAnalyze: checkpoint needs an input file, ignored" << endl;
+		opt_checkpoint = 0;
+		opt_resume = false;
+	}
 
-		if (opt_h) {
-			cout << setw(BLANK) << left << '#';
-			for (int i = 0; i < rule.size(); ++i) {
-				ostringstream sout;
-				sout << "rule" << i + 1;
-				cout << setw(DATAWIDTH) << left << sout.str();
-			}
-			if (!opt_e)
-				cout << endl;
-			else
-				cout << "Energy" << endl;
-		}
+	// count the bytes written for telemetry
+	Telemetry telemetry;
+	CountingBuf countbuf(out->rdbuf(), telemetry.bytesWritten);
+	ostream counted(&countbuf);
+	if (!opt_metrics.empty() || opt_status) {
+		telemetry.Start(opt_metrics, opt_status, opt_metrics_interval);
+		out = &counted;
 	}
-	else if (opt_r) {
 
-		if (!opt_h) {
-			cout << setw(BLANK) << left << '#';
-			for (int i = 0; i < rule.size(); ++i) {
-				ostringstream sout;
-				sout << "rule" << i + 1;
-				cout << setw(DATAWIDTH) << left << sout.str();
-			}
-			if (opt_e)
-				cout << endl;
-			else
-				cout << "Energy" << endl;
-		}
+	// -f: header and energy only with -h / -e; otherwise: header and energy unless -h / -e
+	TextOutput text(*out, opt_f ? opt_h : !opt_h, opt_f ? opt_e : !opt_e);
+	std::unique_ptr<PackedWriter> packed;
+	if (opt_packed > 0) {
+		vector<string> name;
+		for (int i = 0; i < analyzer.ColNum(); ++i)
+			name.push_back(analyzer.ColName(i));
+		packed.reset(new PackedWriter(*out, name, opt_f ? opt_e : !opt_e, opt_packed));
+	}
+	else if (!opt_resume) {
+		text.WriteHeader(analyzer);
 	}
-	else {
 
-		if (!opt_h) {
-			cout << setw(BLANK) << left << '#';
-			for (int iBondType = 0; iBondType < Molecule::nBondtype; ++iBondType) {
-				for (int iBond = 0; iBond < Molecule::nBond[iBondType]; ++iBond) {
-					ostringstream sout;
-					sout << '(' << Molecule::bondtype_list[iBondType] << ')' << iBond + 1;
-					cout << setw(DATAWIDTH) << left << sout.str();
-				}
-			}
-			if (opt_e)
-				cout << endl;
-			else
-				cout << "Energy" << endl;
+	// frame: index of next frame in input
+	long long frame = ckpt.frame;
+	// number of frames analyzed in this run
+	long long done = 0;
+	// frames to warm up buffers before counting allocations
+	constexpr long long WARMUP = 2;
+	long long nAlloc = 0;
+	int tmp;
+	while ((opt_stop < 0 || frame < opt_stop) && reader.ReadCount(tmp)) {
+		// skip unwanted frames by counting lines only
+		if (frame < opt_start || (frame - opt_start) % opt_stride != 0) {
+			if (!reader.SkipLines(tmp + 1LL))
+				break;
+			frame++;
+			continue;
 		}
-	}
 
-		int tmp;
-		while (cin >> tmp) {
-			molc.InputEnergy(cin);
-			molc.InputX(cin);
+		const long long allocBegin = AllocCount();
+		Telemetry::Clock::time_point t;
+		if (telemetry.ifEnabled())
+			t = Telemetry::Clock::now();
 
-			if (opt_f) {
-				if (opt_h)
-					cout << setw(BLANK) << left << ' ';
+		bool ifPass;
+		if (!analyzer.ReadFrame(reader, filter, ifPass))
+			break;
+		if (telemetry.ifEnabled())
+			t = telemetry.Lap(Telemetry::READ, t);
+		if (!ifPass) {
+			frame++;
+			continue;
+		}
 
-				cout << setw(DATAWIDTH) << left << rule[0]->GetBond(molc);
-				if (opt_e)
-					cout << molc.refEnergy() << endl;
-				else
-					cout << endl;
-			}
-			else if (opt_r) {
-				if (!opt_h)
-					cout << setw(BLANK) << left << ' ';
+		analyzer.Analyze(row.data());
+		if (telemetry.ifEnabled())
+			t = telemetry.Lap(Telemetry::ANALYZE, t);
 
-				for (size_t i = 0; i < rule.size(); ++i) {
-					cout << setw(DATAWIDTH) << left << rule[i]->GetBond(molc);
-				}
-				if (opt_e)
-					cout << endl;
-				else
-					cout << molc.refEnergy() << endl;
-			}
-			else {
-				if (!opt_h)
-					cout << setw(BLANK) << left << ' ';
+		if (packed)
+			packed->WriteRow(row.data(), analyzer.Energy());
+		else
+			text.WriteRow(row.data(), analyzer.ColNum(), analyzer.Energy());
+		if (telemetry.ifEnabled()) {
+			telemetry.Lap(Telemetry::WRITE, t);
+			telemetry.frames++;
+			telemetry.bytesRead = reader.Offset();
+		}
 
-				vector<vector<Molecule::Bond>> bond = molc.refBond();
-				for (int iBondtype = 0; iBondtype < Molecule::nBondtype; ++iBondtype) {
-					sort(bond[iBondtype].begin(), bond[iBondtype].end());
+		if (done >= WARMUP)
+			nAlloc += AllocCount() - allocBegin;
 
-					for (int iBond = 0; iBond < Molecule::nBond[iBondtype]; ++iBond) {
-						cout << setw(DATAWIDTH) << left << bond[iBondtype][iBond].getLen();
-					}
-				}
-				if (opt_e)
-					cout << endl;
-				else
-					cout << molc.refEnergy() << endl;
-			}
+		frame++;
+		done++;
+		if (opt_checkpoint > 0 && done % opt_checkpoint == 0) {
+			fout.flush();
+			ckpt.inOffset = reader.Offset();
+			ckpt.frame = frame;
+			ckpt.outOffset = fout.tellp();
+			ckpt.state = analyzer.SaveState();
+
+			if (!Checkpoint::Sync(out_file) || !ckpt.Save(ckpt_file))
+				cerr << "BondAnalyze: checkpoint " << ckpt_file << " save failed" << endl;
 		}
 	}
 
+	if (packed)
+		packed->Flush();
+	out->flush();
+	telemetry.Stop();
+
+	int status = 0;
+	if (opt_alloc_check) {
+		const long long nFrame = (done > WARMUP) ? done - WARMUP : 0;
+		cerr << "BondAnalyze: " << nAlloc << " heap allocations in " << nFrame << " frames after warm-up" << endl;
+		if (nAlloc != 0)
+			status = 1;
+	}
+
+	if (ifFile) {
+		reader.Close();
+		fout.close();
+
+		// the run is complete, the checkpoint is no longer needed
+		if (opt_checkpoint > 0 || opt_resume)
+			remove(ckpt_file.c_str());
+
+		if (cache && status == 0)
+			cache->Store(out_file);
+	}
+
 #ifdef DEBUG_MOLECULE
 	debug.close();
 #endif // DEBUG_MOLECULE
 
-	return 0;
-}
\ No newline at end of file
+	return status;
+}